@@ -1,6 +1,10 @@
 #ifndef __A3_header
 #define __A3_header
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // for sched_setaffinity and the CPU_SET macros
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -14,10 +18,62 @@
 #include <signal.h>
 #include <sys/wait.h>
 #include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <limits.h>
 
 #define MAX_LEN 1024
 #define NOTHING -1
 
+#define MEM_BAR_MAX 100 // longest run of '#' or ':' a memory graphics row can hold
+#define MEM_LINES_MAX 24 // memory lines kept, and shown without --graphics, the oldest being dropped first
+#define CHART_MAX_WIDTH 512 // maximum number of columns a chart is drawn across
+#define CHART_HEIGHT 4 // number of text rows a chart is drawn over
+#define CHART_HISTORY (2 * CHART_MAX_WIDTH) // samples kept per chart, braille packs two samples per column
+#define CHART_LABEL_WIDTH 10 // width of the scale label drawn left of each chart row
+#define CHART_FRAME_LEN (CHART_HEIGHT * (CHART_MAX_WIDTH * 3 + CHART_LABEL_WIDTH + 2) + MAX_LEN) // bytes of one rendered frame
+#define CHART_SPARK 0 // draw charts with block sparkline glyphs
+#define CHART_BRAILLE 1 // draw charts with braille dot glyphs
+#define ARCHIVE_TIERS 3 // resolutions kept by a history archive, finest first
+#define ARCHIVE_RAW 0 // tier of every sample
+#define ARCHIVE_MINUTE 1 // tier of 1-minute rollups
+#define ARCHIVE_HOUR 2 // tier of 1-hour rollups
+#define ARCHIVE_RAW_LEN CHART_HISTORY // samples kept by the raw tier, a count rather than a span of time
+#define ARCHIVE_MINUTE_LEN (24 * 60) // 1-minute rollups kept, a day
+#define ARCHIVE_HOUR_LEN (30 * 24) // 1-hour rollups kept, a month
+#define THERMAL_MAX_CORES 1024 // cores probed for frequency and throttling, keeps a sample well under the pipe capacity
+#define THERMAL_MAX_ZONES 64 // thermal zones probed under /sys/class/thermal
+#define THERMAL_TYPE_LEN 32 // length of a thermal zone type name
+#define THERMAL_PER_ROW 8 // per core frequencies printed on each line
+#define READER_MAX_SLOTS (3 * THERMAL_MAX_CORES + THERMAL_MAX_ZONES + 16) // files the reader can re-read every sample
+#define READER_FD_RESERVE (2 * REGISTRY_MAX + 16) // descriptors left free for stdio, the ring and a pipe per collector
+#define READER_RING_ENTRIES 4096 // largest io_uring submission queue, bigger batches are submitted in pieces
+#define PROC_FILE_LEN (256 * 1024) // slot size for /proc text files, large enough for /proc/stat on hundreds of cores
+#define SYSFS_VALUE_LEN 32 // slot size for sysfs files holding a single value
+#define UTMP_FILE_LEN (256 * sizeof(struct utmp)) // smallest slot for the utmp database, which gets twice its size at start-up if larger
+#define OVERHEAD_DEFAULT_BUDGET 1.0 // cpu time the monitor may use in --low-overhead mode, in percent of one cpu
+#define OVERHEAD_STACK_PREFAULT (256 * 1024) // bytes of stack faulted in before the monitor locks its memory
+#define IRQ_NAME_LEN 16 // bytes of a row label, "24", "NMI", "NET_RX"
+#define IRQ_DESC_LEN 40 // bytes of a row description, the handler of a numbered IRQ
+#define IRQ_TOP 8 // hottest IRQ/cpu cells shown per matrix
+#define VMSTAT_PGFAULT 0 // index of page faults in a vmstat table
+#define VMSTAT_PGMAJFAULT 1 // index of major page faults, those that had to read from disk
+#define VMSTAT_PSWPIN 2 // index of pages swapped in
+#define VMSTAT_PSWPOUT 3 // index of pages swapped out
+#define VMSTAT_PGSCAN 4 // index of pages scanned for reclaim, by kswapd and directly
+#define VMSTAT_PGSTEAL 5 // index of pages reclaimed, by kswapd and directly
+#define VMSTAT_OOM_KILL 6 // index of processes killed by the OOM killer
+#define VMSTAT_COUNTERS 7 // entries of a vmstat table
+#define REGISTRY_MAX 32 // collectors a registry can hold, one reader group bit each
+#define READER_ALL_GROUPS (~0u) // reader group of slots read by every batch
+
 /**
  *  @brief Represents a memory struct.
  *  stores information about a memory's total, free, available, buffers, cached, and swap.
@@ -25,6 +81,9 @@
 typedef struct {
     char mem_str[MAX_LEN];
     double virt_used;
+    double phys_used; // GB
+    double phys_total; // GB
+    double virt_total; // GB
 } mem_struct;
 
 /**
@@ -59,6 +118,304 @@ typedef struct queue {
     User *tail;  // pointer to tail of queue
 } users;
 
+/**
+ *  @brief Represents a chart struct.
+ *  stores a ring buffer of the newest samples of a series, its scale, and the buffer a frame is rendered into.
+**/
+typedef struct chart {
+    double values[CHART_HISTORY]; // ring buffer of the newest samples
+    int head; // index the next sample is written to
+    int count; // number of valid samples in the ring
+    double lo; // bottom of the scale
+    double hi; // top of the scale, the chart auto-scales to the visible samples when hi <= lo
+    char frame[CHART_FRAME_LEN]; // every row of a frame is rendered into this one buffer
+} chart_struct;
+
+/**
+ *  @brief Represents an archive point.
+ *  stores the lowest, average and highest sample of one rollup period (all three are the sample itself in the raw tier,
+ *  and NaN for a period without samples).
+**/
+typedef struct archive_point {
+    double min; // lowest sample of the period
+    double avg; // average of the samples of the period
+    double max; // highest sample of the period
+} archive_point;
+
+/**
+ *  @brief Represents an archive tier.
+ *  stores a ring of points of one resolution, and the period being folded into its next point.
+**/
+typedef struct archive_tier {
+    long period_ms; // milliseconds rolled up into one point, 0 for the raw tier
+    int len; // points the ring can hold
+    int head; // index the next point is written to
+    int count; // number of valid points in the ring
+    archive_point *points; // ring of points, inside the archive's single allocation
+    long bucket; // index (time / period_ms) of the period being folded
+    double min, max, sum; // lowest, highest and sum of the samples folded into the current period
+    int n; // number of samples folded into the current period
+} archive_tier;
+
+/**
+ *  @brief Represents an archive struct.
+ *  stores the history of one series at every resolution, RRD style, in memory allocated once by archive_init.
+**/
+typedef struct archive {
+    archive_tier tiers[ARCHIVE_TIERS]; // raw samples, 1-minute and 1-hour rollups
+    archive_point *storage; // points of every tier
+    chart_struct view; // the zoomed tier is copied into this chart to draw it
+} archive_struct;
+
+/**
+ *  @brief Represents a thermal struct.
+ *  stores the reader slots of every core's frequency and throttle counters and of every thermal zone,
+ *  opened once so that each sample only re-reads them. A sample is an array of n_values longs laid out as
+ *  [frequency (kHz) x n_cores][core throttle count x n_cores][package throttle count x n_packages][temperature (mC) x n_zones],
+ *  with -1 for any value this machine does not expose.
+**/
+typedef struct thermal {
+    int n_cores; // number of cores probed
+    int n_packages; // number of physical packages the cores belong to
+    int n_zones; // number of thermal zones found
+    int n_values; // number of longs in a sample
+    int freq_slot[THERMAL_MAX_CORES]; // reader slot of cpuN/cpufreq/scaling_cur_freq, -1 if missing
+    int core_throttle_slot[THERMAL_MAX_CORES]; // reader slot of cpuN/thermal_throttle/core_throttle_count, -1 if missing
+    int pkg_throttle_slot[THERMAL_MAX_CORES]; // reader slot of package_throttle_count of the first cpu of each package, -1 if missing
+    int zone_slot[THERMAL_MAX_ZONES]; // reader slot of thermal_zoneN/temp
+    char zone_type[THERMAL_MAX_ZONES][THERMAL_TYPE_LEN]; // thermal_zoneN/type
+} thermal_struct;
+
+/**
+ *  @brief Represents a read slot.
+ *  stores an open file the reader re-reads from offset 0 every sample and the part of the arena it is read into.
+**/
+typedef struct read_slot {
+    int fd; // descriptor opened once by reader_add, -1 for a file opened and closed at every read
+    char *path; // path of a file opened and closed at every read, NULL otherwise
+    int fixed; // index of the descriptor among the files registered with the ring, -1 if it is not registered
+    unsigned group; // bit of the collector the slot belongs to, a batch only reads the groups it is asked for
+    size_t cap; // bytes the slot can hold, longer files are truncated
+    ssize_t len; // bytes read by the last sample, or a negative value if the read failed
+    char *buf; // NUL terminated contents, inside the reader arena
+} read_slot;
+
+/**
+ *  @brief Represents a reader struct.
+ *  stores every file read each sample, the single arena they are read into, and the io_uring rings used to
+ *  submit all of a sample's reads as one batch. ring_fd is -1 when the reader falls back to pread.
+**/
+typedef struct reader {
+    int n_slots; // number of files added
+    read_slot slots[READER_MAX_SLOTS]; // files in the order they were added
+    unsigned group; // group given to the slots added next
+    int n_open; // number of descriptors the slots keep open
+    int fd_budget; // descriptors the slots may keep open, the files added past it are opened at every read
+    int n_read; // number of slots read by the last reader_submit
+    int n_kept; // number of pending slots with a descriptor kept open, they come first in pending
+    int pending[READER_MAX_SLOTS]; // slots read by the last reader_submit
+    char *arena; // one buffer holding every slot, registered with the ring
+    size_t arena_len; // size of the arena in bytes
+    int syscalls; // syscalls made by the last reader_submit
+    int ring_fd; // io_uring descriptor, -1 when reading with pread
+    int fixed_buffers; // 1 if the arena is registered and reads use IORING_OP_READ_FIXED
+    void *sq_ring, *cq_ring; // ring mappings (cq_ring is NULL when both share the sq mapping)
+    size_t sq_len, cq_len, sqes_len; // sizes of the mappings
+    unsigned *sq_head, *sq_tail, *sq_array, *cq_head, *cq_tail; // ring indices shared with the kernel
+    unsigned sq_mask, cq_mask, sq_entries; // ring geometry
+    struct io_uring_sqe *sqes; // submission queue entries
+    struct io_uring_cqe *cqes; // completion queue entries
+} reader_struct;
+
+/**
+ *  @brief Represents an overhead struct.
+ *  stores the settings of --low-overhead mode and the cpu time the monitor used over the last sample.
+**/
+typedef struct overhead {
+    int enabled; // 1 in --low-overhead mode
+    int cpu; // housekeeping cpu the monitor is pinned to
+    double budget; // most cpu time the monitor may use, in percent of one cpu
+    double used; // cpu time used over the last sample, in percent of one cpu
+    double cpu_time; // cpu seconds used by the monitor and its children at the last check
+    double wall_time; // monotonic seconds at the last check
+    int lowered; // number of times the sampling rate was lowered
+} overhead_struct;
+
+/**
+ *  @brief Represents an IRQ matrix.
+ *  stores the layout of /proc/interrupts or /proc/softirqs, one row per IRQ and one column per cpu. The counts
+ *  themselves live in flat arrays of n_rows * n_cpus unsigned ints, row after row, so any number of samples and
+ *  their deltas can share one matrix.
+**/
+typedef struct irq_matrix {
+    int n_rows; // rows found when the matrix was opened, rows that appear later are not tracked
+    int n_cpus; // cpu columns
+    int *cpu_ids; // cpu number of every column, from the CPUn header (offline cpus have no column)
+    char (*names)[IRQ_NAME_LEN]; // label of every row
+    char (*descs)[IRQ_DESC_LEN]; // handler of every numbered IRQ, the description of every named one
+} irq_matrix;
+
+/**
+ *  @brief Represents an IRQ cell.
+ *  stores the count a cell of an IRQ matrix gained over a sample.
+**/
+typedef struct irq_cell {
+    int row; // row of the cell
+    int col; // column of the cell
+    unsigned delta; // count gained over the sample
+} irq_cell;
+
+/**
+ *  @brief Represents a display struct.
+ *  stores the display options every collector renders with, and the index of the frame being rendered.
+**/
+typedef struct display {
+    int i; // index of the frame being rendered
+    int samples; // number of frames
+    int tdelay; // seconds between frames
+    int sequential; // sequential flag
+    int graphics; // graphics flag
+    int chart_style; // CHART_SPARK or CHART_BRAILLE
+    int zoom; // archive tier the charts show
+    int show_system; // 1 unless only --user was given
+    int show_users; // 1 unless only --system was given
+    int machine; // 1 to print encoded records instead of rendering
+    int lowered; // number of times --low-overhead lowered the sampling rate
+} display_struct;
+
+/**
+ *  @brief Represents a collector.
+ *  a metric plugged into the registry. Every collector samples on its own interval; sample may run in a forked
+ *  child process, so its results must be written into the payload, the only data piped back to the main process.
+**/
+typedef struct collector {
+    const char *name; // name used by --interval=NAME:MS and in encoded records
+    int interval_ms; // milliseconds between samples, 0 to sample every tdelay seconds
+    int enabled; // 0 when the options given leave the collector out
+    int (*init)(struct collector *c, reader_struct *reader, display_struct *display); // adds files to the reader and allocates state and payload, -1 disables the collector
+    void (*sample)(struct collector *c, reader_struct *reader); // fills the payload from the files the reader just read
+    void (*record)(struct collector *c, display_struct *display, long now); // folds a new payload, sampled at monotonic time now, into history kept in the main process, may be NULL
+    int (*encode)(struct collector *c, char *buf, size_t size); // writes the payload as a machine-readable record, returns its length
+    void (*render)(struct collector *c, display_struct *display); // prints the collector's section of a frame
+    void (*teardown)(struct collector *c); // frees state and payload
+    void *state; // data kept in the main process only
+    void *payload; // result of the last sample
+    size_t payload_len; // bytes of the payload in use
+    size_t payload_cap; // bytes allocated for the payload
+    unsigned group; // reader group bit of the collector's files
+    long next_ms; // monotonic time the collector is next due
+} collector;
+
+/**
+ *  @brief Represents a registry struct.
+ *  stores the collectors in the order their sections are rendered.
+**/
+typedef struct registry {
+    int n; // number of collectors
+    collector *collectors[REGISTRY_MAX]; // registered collectors
+} registry_struct;
+
+/**
+ *  @brief Represents the memory collector's state.
+ *  stores the slot of /proc/meminfo, the display lines of the last frames, and the virtual memory history.
+**/
+typedef struct memory_state {
+    int meminfo_slot; // reader slot of /proc/meminfo
+    char lines[MEM_LINES_MAX][1024]; // memory lines of the last MEM_LINES_MAX frames, a ring indexed by frame
+    double prev_virt; // virtual memory used at the previous frame
+    archive_struct archive; // virtual memory used at every sample, and its rollups
+} memory_state;
+
+/**
+ *  @brief Represents the users collector's state.
+ *  stores the slot of the utmp database and its size.
+**/
+typedef struct users_state {
+    int utmp_slot; // reader slot of the utmp database
+    size_t utmp_cap; // bytes of the database the slot holds
+} users_state;
+
+/**
+ *  @brief Represents the users collector's payload.
+ *  stores the utmp records of the users logged in, and whether the database outgrew its slot.
+**/
+typedef struct users_payload {
+    int truncated; // 1 if the database filled its slot, so records past it were not read
+    int n_records; // number of records
+    struct utmp records[]; // records of the users logged in
+} users_payload;
+
+/**
+ *  @brief Represents the cpu collector's state.
+ *  stores the slot of /proc/stat, the frequency/thermal slots and the previous frame's values, and the cpu usage history.
+**/
+typedef struct cpu_state {
+    int stat_slot; // reader slot of /proc/stat
+    thermal_struct thermal; // reader slots of the frequency/thermal files
+    long *thermal_prev; // frequency/thermal values at the previous frame
+    archive_struct archive; // cpu usage at every sample, and its rollups
+} cpu_state;
+
+/**
+ *  @brief Represents the cpu collector's payload.
+ *  stores the raw /proc/stat values of the last sample (the next usage is measured against them), the usage, and
+ *  the frequency/thermal sample laid out as described for thermal_struct.
+**/
+typedef struct cpu_payload {
+    cpu_struct last; // /proc/stat values of the last sample
+    float usage; // cpu usage between the last two samples
+    long thermal[]; // thermal.n_values frequency/thermal values
+} cpu_payload;
+
+/**
+ *  @brief Represents the IRQ collector's state.
+ *  stores the slots and layouts of /proc/interrupts and /proc/softirqs, and scratch arrays for parsing and deltas.
+**/
+typedef struct irq_state {
+    int hard_slot; // reader slot of /proc/interrupts
+    int soft_slot; // reader slot of /proc/softirqs
+    irq_matrix hard; // layout of /proc/interrupts
+    irq_matrix soft; // layout of /proc/softirqs
+    unsigned *cur; // counts just parsed, hard cells then soft cells
+    unsigned *delta; // counts gained since the previous sample, hard cells then soft cells
+} irq_state;
+
+/**
+ *  @brief Represents the IRQ collector's payload.
+ *  stores the counts of the last sample (the next deltas are measured against them) and the hottest cells.
+**/
+typedef struct irq_payload {
+    long sampled_ms; // monotonic time of the last sample
+    long elapsed_ms; // milliseconds between the last two samples
+    unsigned long hard_total; // interrupts over the last sample, every cell of /proc/interrupts
+    unsigned long soft_total; // softirqs over the last sample, every cell of /proc/softirqs
+    int n_hard_top; // cells in hard_top
+    int n_soft_top; // cells in soft_top
+    irq_cell hard_top[IRQ_TOP]; // hottest cells of /proc/interrupts, hottest first
+    irq_cell soft_top[IRQ_TOP]; // hottest cells of /proc/softirqs, hottest first
+    unsigned counts[]; // counts of the last sample, hard cells then soft cells
+} irq_payload;
+
+/**
+ *  @brief Represents the vmstat collector's state.
+ *  stores the slot of /proc/vmstat.
+**/
+typedef struct vmstat_state {
+    int vmstat_slot; // reader slot of /proc/vmstat
+} vmstat_state;
+
+/**
+ *  @brief Represents the vmstat collector's payload.
+ *  stores the paging and swap counters of the last sample, indexed by VMSTAT_*, and what they gained since the one before.
+**/
+typedef struct vmstat_payload {
+    long sampled_ms; // monotonic time of the last sample
+    long elapsed_ms; // milliseconds between the last two samples
+    unsigned present; // bit VMSTAT_* is set for every counter this kernel reports
+    unsigned long long last[VMSTAT_COUNTERS]; // counters of the last sample
+    unsigned long long delta[VMSTAT_COUNTERS]; // counters gained between the last two samples
+} vmstat_payload;
+
 /**
  *  @brief Represents a sample struct.
  *  stores information about a sample's previous and current virtual memory.
@@ -71,23 +428,12 @@ typedef struct sample {
 
 
 /**
-* @brief Write the memory information to the pipe.
-* @param write_fd the file descriptor to write to
-* @param prev_virt the previous virtual memory
-* @param str the string to write to the pipe
-* @param i the index of the sample
-* @param graphics the graphics flag
-* @return None
-*/
-void write_memory_pipe(int write_fd, double *prev_virt, char str[MAX_LEN], int i, int graphics);
-
-/**
-* @brief Write the memory information to the pipe.
-* @param str the string to write to the pipe
-* @param i the index of the sample
+* @brief Store the memory information parsed from /proc/meminfo in a mem_struct.
+* @param mem the struct to store the memory information and its display string in
+* @param meminfo the contents of /proc/meminfo read by the reader
 * @return double the virtual memory used
 */
-double write_memory(char str[MAX_LEN], int i);
+double write_memory(mem_struct *mem, const char *meminfo);
 
 
 /**
@@ -107,26 +453,40 @@ void enqueue(users *q, char line[UT_LINESIZE + UT_NAMESIZE + UT_HOSTSIZE + 10]);
 users *setUp(void);
 
 /**
-* @brief Write the user information to the pipe.
-* @param write_fd the file descriptor to write to
-* @return None
+* @brief Copy the utmp record at byte off out of the records read (so it is suitably aligned) and tell whether it is a
+* user logged in.
+* @param utmp the utmp records read by the reader
+* @param off the byte offset of the record
+* @param record the record to copy into
+* @return int 1 if the record belongs to a user currently logged in and running a process, 0 otherwise
 */
-void write_users_pipe(int write_fd);
+int user_record(const char *utmp, ssize_t off, struct utmp *record);
 
 /**
-* @brief Read the user information from the pipe.
-* @param read_fd the file descriptor to read from
+* @brief Build the queue of users straight from the utmp records, without a pipe.
+* @param utmp the utmp records read by the reader
+* @param utmp_len the number of bytes of utmp records
 * @return users* the queue of users
 */
-users* read_users_pipe(int read_fd);
+users *read_users(const char *utmp, ssize_t utmp_len);
+
+/**
+* @brief Read exactly len bytes from a pipe, looping over short reads and reads interrupted by a signal.
+* @param read_fd the file descriptor to read from
+* @param buf the buffer to read into
+* @param len the number of bytes to read
+* @return ssize_t the number of bytes read, less than len if the pipe was closed or failed
+*/
+ssize_t read_all(int read_fd, void *buf, size_t len);
 
 /**
-* @brief Write the cpu information to the pipe.
+* @brief Write exactly len bytes to a pipe, looping over short writes and writes interrupted by a signal.
 * @param write_fd the file descriptor to write to
-* @param prev the previous cpu struct
-* @return None
+* @param buf the buffer to write from
+* @param len the number of bytes to write
+* @return ssize_t the number of bytes written, less than len if the pipe was closed or failed
 */
-void write_cpu_pipe(int write_fd, cpu_struct *prev);
+ssize_t write_all(int write_fd, const void *buf, size_t len);
 
 /**
 * @brief Delete the users in the queue.
@@ -153,11 +513,12 @@ void display_header(int i, int sequential, int samples, int tdelay);
 void print_cores(void);
 
 /**
-* @brief Set the cpu values.
+* @brief Set the cpu values from the first line of /proc/stat.
 * @param sample the cpu struct to set
+* @param stat the contents of /proc/stat read by the reader
 * @return None
 */
-void set_cpu_values(cpu_struct *sample);
+void set_cpu_values(cpu_struct *sample, const char *stat);
 
 /**
 * @brief Calculate the cpu usage.
@@ -186,29 +547,407 @@ void print_machine_info(void);
 * @param i the index of the sample
 * @param virt_used the virtual memory used
 * @param prev_virt the previous virtual memory
-* @param strArr the array of strings to modify
+* @param line the memory line of the sample, to modify
 * @return None
 */
-void modify_memory_graphics(int i, double virt_used, double *prev_virt, char strArr[][1024]);
+void modify_memory_graphics(int i, double virt_used, double *prev_virt, char line[1024]);
 
 /**
-* @brief Display the memory string at strArr[i].
+* @brief Display the memory line of frame i: on its own row out of samples with sequential, under the lines of the
+* newest frames otherwise.
 * @param sequential the sequential flag
 * @param samples the number of samples
+* @param rows the number of lines of history to show without sequential, at most MEM_LINES_MAX
 * @param i the index of the sample
-* @param strArr the array of strings to display
+* @param strArr the ring of the last MEM_LINES_MAX memory lines, indexed by frame
 * @return None
 */
-void display_memory_line(int sequential, int samples, int i, char strArr[][1024]);
+void display_memory_line(int sequential, int samples, int rows, int i, char strArr[][1024]);
 
 /**
-* @brief Display the cpu string at cpuArr[i].
-* @param sequential the sequential flag
-* @param samples the number of samples
+* @brief Parse the paging and swap counters out of /proc/vmstat into a table indexed by VMSTAT_*.
+* @param vmstat the contents of /proc/vmstat read by the reader, NULL if the read failed
+* @param values the table to fill, pgscan and pgsteal summed over kswapd, direct and other reclaim, untouched if vmstat is NULL
+* @return unsigned the bits (1 << VMSTAT_*) of the counters found, 0 if vmstat is NULL
+*/
+unsigned vmstat_parse(const char *vmstat, unsigned long long values[VMSTAT_COUNTERS]);
+
+/**
+* @brief Get the per-second rate of a vmstat counter over the last sample.
+* @param vmstat the vmstat payload
+* @param counter VMSTAT_PGFAULT ... VMSTAT_OOM_KILL
+* @return double the rate per second, 0 if the counter is missing
+*/
+double vmstat_rate(vmstat_payload *vmstat, int counter);
+
+/**
+* @brief Print the paging and swap rates under the memory lines.
+* @param vmstat the vmstat payload
+* @return None
+*/
+void print_vmstat(vmstat_payload *vmstat);
+
+/**
+* @brief Display the cpu usage history chart at the given zoom level.
+* @param archive the archive holding the cpu usage history
+* @param style CHART_SPARK or CHART_BRAILLE
+* @param zoom ARCHIVE_RAW, ARCHIVE_MINUTE or ARCHIVE_HOUR
+* @return None
+*/
+void cpu_graphics(archive_struct *archive, int style, int zoom);
+
+/**
+* @brief Add the frequency, throttle and thermal zone files of every core and zone to the reader.
+* @param thermal the struct to store the reader slots in
+* @param reader the reader the files are added to, before reader_start
+* @return int the number of files added, 0 when this machine exposes none of them
+*/
+int thermal_open(thermal_struct *thermal, reader_struct *reader);
+
+/**
+* @brief Parse a frequency/thermal sample out of the files the reader read.
+* @param thermal the reader slots
+* @param reader the reader holding the sample's files
+* @param values the array of thermal->n_values longs to fill
+* @return None
+*/
+void thermal_read(thermal_struct *thermal, reader_struct *reader, long *values);
+
+/**
+* @brief Print the per core frequencies, throttle events and zone temperatures.
+* @param thermal the reader slots
+* @param cur the current sample
+* @param prev the previous sample, used for throttle deltas
 * @param i the index of the sample
-* @param cpuArr the array of strings to display
 * @return None
 */
-void cpu_graphics(char cpuArr[][200], int i, int sequential, int *num_bar, float cur_cpu_usage, float *prev_cpu_usage);
+void print_thermal(thermal_struct *thermal, long *cur, long *prev, int i);
+
+/**
+* @brief Pin the monitor to its housekeeping cpu, run it under SCHED_IDLE and the lowest nice value,
+* and fault in and lock its memory. Failures are reported to stderr and the monitor carries on.
+* @param overhead the low-overhead settings
+* @return None
+*/
+void overhead_enter(overhead_struct *overhead);
+
+/**
+* @brief Measure the cpu time used since the last check and halve the sampling rate if it is over budget.
+* @param overhead the low-overhead settings
+* @param tdelay the delay between samples, doubled when the budget is exceeded
+* @return int 1 if the sampling rate was lowered, 0 otherwise
+*/
+int overhead_check(overhead_struct *overhead, int *tdelay);
+
+/**
+* @brief Print the cpu time used over the last sample against the budget.
+* @param overhead the low-overhead settings
+* @param tdelay the delay between samples
+* @param lowered 1 if the sampling rate was just lowered
+* @return None
+*/
+void print_overhead(overhead_struct *overhead, int tdelay, int lowered);
+
+/**
+* @brief Initialize an empty reader, raising the soft limit of open files toward the hard limit for its slots.
+* @param reader the reader to initialize
+* @return None
+*/
+void reader_init(reader_struct *reader);
+
+/**
+* @brief Open a file once and give it a slot the reader re-reads every sample. Past the descriptor budget the file
+* is closed again and reopened at every read instead.
+* @param reader the reader, before reader_start
+* @param path the path of the file
+* @param cap the most bytes read from the file
+* @return int the slot of the file, -1 if it cannot be opened
+*/
+int reader_add(reader_struct *reader, const char *path, size_t cap);
+
+/**
+* @brief Allocate the arena and set up io_uring with every slot's file and the arena registered.
+* @param reader the reader to start
+* @return int 1 if reads go through io_uring, 0 if they fall back to pread
+*/
+int reader_start(reader_struct *reader);
+
+/**
+* @brief Read the slots of the given groups from offset 0, as one io_uring batch collected with a single wait, or one pread per slot.
+* A read the ring rejects is done again with pread, and the reader stays on pread once the ring rejects a whole batch.
+* @param reader the reader to submit
+* @param groups the groups to read, READER_ALL_GROUPS for every slot
+* @return int the number of syscalls made
+*/
+int reader_submit(reader_struct *reader, unsigned groups);
+
+/**
+* @brief Get the NUL terminated contents a slot held at the last reader_submit.
+* @param reader the reader
+* @param slot the slot returned by reader_add
+* @return char* the contents, NULL if the slot does not exist or its read failed
+*/
+char *reader_data(reader_struct *reader, int slot);
+
+/**
+* @brief Get the number of bytes a slot held at the last reader_submit.
+* @param reader the reader
+* @param slot the slot returned by reader_add
+* @return ssize_t the number of bytes, negative if the slot does not exist or its read failed
+*/
+ssize_t reader_len(reader_struct *reader, int slot);
+
+/**
+* @brief Print how the last batch was read and the syscalls saved compared to one pread per open file.
+* @param reader the reader
+* @return None
+*/
+void print_reader(reader_struct *reader);
+
+/**
+* @brief Tear down the ring and close every file of the reader.
+* @param reader the reader to close
+* @return None
+*/
+void reader_close(reader_struct *reader);
+
+/**
+* @brief Initialize a chart with an empty history.
+* @param chart the chart to initialize
+* @param lo the bottom of the scale
+* @param hi the top of the scale, or a value <= lo to auto-scale to the visible samples
+* @return None
+*/
+void chart_init(chart_struct *chart, double lo, double hi);
+
+/**
+* @brief Append a sample to the chart history in O(1) time, overwriting the oldest one when full.
+* @param chart the chart to append to
+* @param value the sample to append
+* @return None
+*/
+void chart_push(chart_struct *chart, double value);
+
+/**
+* @brief Render the newest samples of the chart into chart->frame in O(width) time.
+* @param chart the chart to render
+* @param style CHART_SPARK or CHART_BRAILLE
+* @param width the number of terminal columns the chart may use
+* @param label the title printed above the chart
+* @return size_t the number of bytes rendered into chart->frame
+*/
+size_t chart_render(chart_struct *chart, int style, int width, const char *label);
+
+/**
+* @brief Render the chart scaled to the terminal width and write the frame to stdout at once.
+* @param chart the chart to display
+* @param style CHART_SPARK or CHART_BRAILLE
+* @param label the title printed above the chart
+* @return None
+*/
+void display_chart(chart_struct *chart, int style, const char *label);
+
+/**
+* @brief Get the width of the terminal attached to stdout.
+* @param None
+* @return int the number of columns, 80 when it cannot be determined
+*/
+int terminal_width(void);
+
+/**
+* @brief Add a collector to the end of the registry.
+* @param registry the registry to add to
+* @param c the collector to add
+* @return int 0 on success, -1 if the registry is full
+*/
+int registry_add(registry_struct *registry, collector *c);
+
+/**
+* @brief Find a collector by name.
+* @param registry the registry to search
+* @param name the name of the collector
+* @return collector* the collector, NULL if there is none by that name
+*/
+collector *registry_find(registry_struct *registry, const char *name);
+
+/**
+* @brief Initialize every enabled collector, giving each a reader group for its files. Called before reader_start.
+* @param registry the registry to initialize
+* @param reader the reader the collectors add their files to
+* @param display the display options
+* @return None
+*/
+void registry_init(registry_struct *registry, reader_struct *reader, display_struct *display);
+
+/**
+* @brief Take a first sample of every collector in this process and schedule their next samples.
+* @param registry the registry to start
+* @param reader the started reader
+* @param now the current monotonic time in milliseconds
+* @return None
+*/
+void registry_start(registry_struct *registry, reader_struct *reader, long now);
+
+/**
+* @brief Sample every collector that is due: read their files in one batch, then run each sample in a forked
+* child process that pipes the payload back, or in this process, and record the new payloads.
+* @param registry the registry to sample
+* @param reader the reader
+* @param display the display options
+* @param now the current monotonic time in milliseconds
+* @param fork_mode 1 to sample in child processes, 0 to sample in this process
+* @return int the number of collectors sampled
+*/
+int registry_sample(registry_struct *registry, reader_struct *reader, display_struct *display, long now, int fork_mode);
+
+/**
+* @brief Get the time the next collector is due.
+* @param registry the registry
+* @return long the monotonic time in milliseconds, LONG_MAX if no collector is enabled
+*/
+long registry_next(registry_struct *registry);
+
+/**
+* @brief Halve the sampling rate of every collector.
+* @param registry the registry
+* @return None
+*/
+void registry_lower_rate(registry_struct *registry);
+
+/**
+* @brief Render the section of every enabled collector, in registration order.
+* @param registry the registry
+* @param display the display options and frame index
+* @return None
+*/
+void registry_render(registry_struct *registry, display_struct *display);
+
+/**
+* @brief Print the machine-readable record of every enabled collector, one line each prefixed by the frame index and
+* followed by the collector's effective sampling interval and how many times the rate was lowered.
+* @param registry the registry
+* @param display the display options and frame index
+* @return None
+*/
+void registry_encode(registry_struct *registry, display_struct *display);
+
+/**
+* @brief Tear down every enabled collector.
+* @param registry the registry
+* @return None
+*/
+void registry_teardown(registry_struct *registry);
+
+/**
+* @brief Get the current time of the monotonic clock.
+* @param None
+* @return long the time in milliseconds
+*/
+long monotonic_ms(void);
+
+/**
+* @brief Allocate the points of every tier of an archive at once and initialize it empty.
+* @param archive the archive to initialize
+* @param lo bottom of the chart scale
+* @param hi top of the chart scale, charts auto-scale when hi <= lo
+* @return None
+*/
+void archive_init(archive_struct *archive, double lo, double hi);
+
+/**
+* @brief Fold a sample into every tier in O(1) time, closing the rollup period it falls past and recording the periods
+* skipped since as gaps (at most one ring of them).
+* @param archive the archive to fold into
+* @param now the monotonic time of the sample in milliseconds
+* @param value the sample
+* @return None
+*/
+void archive_push(archive_struct *archive, long now, double value);
+
+/**
+* @brief Display the newest points of one tier as a chart scaled to the terminal width, in O(width) time.
+* @param archive the archive to display
+* @param zoom the tier to display, ARCHIVE_RAW, ARCHIVE_MINUTE or ARCHIVE_HOUR
+* @param style CHART_SPARK or CHART_BRAILLE
+* @param label the name of the series, printed above the chart with the resolution
+* @return None
+*/
+void display_archive(archive_struct *archive, int zoom, int style, const char *label);
+
+/**
+* @brief Get the name of a zoom level.
+* @param zoom ARCHIVE_RAW, ARCHIVE_MINUTE or ARCHIVE_HOUR
+* @return const char* "raw", "minute" or "hour"
+*/
+const char *archive_zoom_name(int zoom);
+
+/**
+* @brief Free the points of an archive.
+* @param archive the archive to free
+* @return None
+*/
+void archive_free(archive_struct *archive);
+
+/**
+* @brief Learn the layout of an IRQ matrix (cpu columns, row labels and descriptions) from the text of the file.
+* @param matrix the matrix to open
+* @param text the NUL terminated contents of /proc/interrupts or /proc/softirqs
+* @return int the number of cells, n_rows * n_cpus, or -1 if the text has no CPUn header
+*/
+int irq_matrix_open(irq_matrix *matrix, const char *text);
+
+/**
+* @brief Parse the counts of every known row out of the text of the file in one pass.
+* @param matrix the matrix layout
+* @param text the NUL terminated contents the reader read, NULL leaves the counts as they are
+* @param counts the n_rows * n_cpus counts to fill, cells of rows missing from the text are left as they are
+* @return int the number of rows parsed
+*/
+int irq_matrix_parse(irq_matrix *matrix, const char *text, unsigned *counts);
+
+/**
+* @brief Compute cur - prev for every cell, several cells per instruction, wrapping like the kernel's counters.
+* @param cur the counts of the current sample
+* @param prev the counts of the previous sample
+* @param delta the counts gained, may be the same array as cur
+* @param cells the number of cells
+* @return unsigned long the sum of every delta
+*/
+unsigned long irq_matrix_delta(const unsigned *cur, const unsigned *prev, unsigned *delta, int cells);
+
+/**
+* @brief Find the cells that gained the most, skipping blocks of cells that cannot make it into the top.
+* @param matrix the matrix layout
+* @param delta the counts gained
+* @param top the array to store the hottest cells in, hottest first
+* @param k the number of cells top can hold
+* @return int the number of cells stored, only cells that gained something are stored
+*/
+int irq_matrix_hottest(irq_matrix *matrix, const unsigned *delta, irq_cell *top, int k);
+
+/**
+* @brief Print the hottest cells of a matrix as rates per second, one cell per line.
+* @param matrix the matrix layout
+* @param title the name of the matrix
+* @param top the hottest cells
+* @param n the number of cells in top
+* @param total the sum of every delta
+* @param elapsed_ms the milliseconds the deltas were gained over
+* @return None
+*/
+void print_irqs(irq_matrix *matrix, const char *title, irq_cell *top, int n, unsigned long total, long elapsed_ms);
+
+/**
+* @brief Free the layout of a matrix.
+* @param matrix the matrix to close
+* @return None
+*/
+void irq_matrix_close(irq_matrix *matrix);
+
+extern collector memory_collector; // physical and virtual memory used, from /proc/meminfo
+extern collector vmstat_collector; // paging and swap rates, from /proc/vmstat
+extern collector users_collector; // sessions of logged in users, from the utmp database
+extern collector cpu_collector; // cpu usage from /proc/stat, with per core frequency, throttling and temperatures
+extern collector irq_collector; // hottest IRQ/cpu cells, from /proc/interrupts and /proc/softirqs
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,126 @@
+#include "a3.h"
+
+// An archive keeps the history of one series (memory or cpu usage) at several resolutions, like an RRDtool database:
+// the last ARCHIVE_RAW_LEN samples, whatever the delay between them, 1-minute min/avg/max rollups for a day and 1-hour
+// rollups for a month. Each tier is a fixed ring allocated once, and every sample is folded into the open period of
+// each rollup tier as it arrives, so a week-long run costs the same memory and the same time per sample as a short
+// one. A rollup tier holds one point per period, periods without a sample being gaps, so its points sit on a time axis.
+
+static const char *zoom_names[ARCHIVE_TIERS] = {"raw", "minute", "hour"};
+static const char *zoom_labels[ARCHIVE_TIERS] = {"every sample", "1-minute averages", "1-hour averages"};
+
+void archive_init(archive_struct *archive, double lo, double hi){
+    const long periods[ARCHIVE_TIERS] = {0, 60 * 1000L, 60 * 60 * 1000L};
+    const int lens[ARCHIVE_TIERS] = {ARCHIVE_RAW_LEN, ARCHIVE_MINUTE_LEN, ARCHIVE_HOUR_LEN};
+    int total = 0;
+
+    for(int t=0; t<ARCHIVE_TIERS; t++) total += lens[t];
+
+    archive->storage = (archive_point *)calloc(total, sizeof(archive_point)); //every tier in one allocation, made before sampling starts
+    if(archive->storage == NULL){
+        perror("calloc");
+        exit(1);
+    }
+
+    total = 0;
+    for(int t=0; t<ARCHIVE_TIERS; t++){
+        archive_tier *tier = &archive->tiers[t];
+
+        memset(tier, 0, sizeof(*tier));
+        tier->period_ms = periods[t];
+        tier->len = lens[t];
+        tier->points = archive->storage + total;
+        total += lens[t];
+    }
+
+    chart_init(&archive->view, lo, hi);
+}
+
+// appends a point to the ring of a tier, overwriting the oldest one once the ring is full
+static void tier_append(archive_tier *tier, double min, double avg, double max){
+    tier->points[tier->head] = (archive_point){min, avg, max};
+    tier->head = (tier->head + 1) % tier->len;
+    if(tier->count < tier->len) tier->count++;
+}
+
+void archive_push(archive_struct *archive, long now, double value){
+    tier_append(&archive->tiers[ARCHIVE_RAW], value, value, value);
+
+    for(int t=ARCHIVE_RAW + 1; t<ARCHIVE_TIERS; t++){
+        archive_tier *tier = &archive->tiers[t];
+        long bucket = now / tier->period_ms;
+
+        if(tier->n > 0 && bucket != tier->bucket){ //the sample falls past the open period, which becomes a point
+            long gaps = bucket - tier->bucket - 1;
+
+            tier_append(tier, tier->min, tier->sum / tier->n, tier->max);
+            if(gaps > tier->len) gaps = tier->len; //a longer silence overwrites the whole ring anyway
+            for(long g=0; g<gaps; g++) tier_append(tier, NAN, NAN, NAN); //periods without a sample (a long tdelay, a stopped monitor) are gaps
+            tier->n = 0;
+        }
+
+        if(tier->n == 0){
+            tier->bucket = bucket;
+            tier->min = tier->max = value;
+            tier->sum = 0.0;
+        }
+
+        if(value < tier->min) tier->min = value;
+        if(value > tier->max) tier->max = value;
+        tier->sum += value;
+        tier->n++;
+    }
+}
+
+// returns the n-th newest point of a tier (0 being the newest), counting the open period of a rollup tier as the newest
+static archive_point tier_at(archive_tier *tier, int n){
+    if(tier->n > 0){
+        if(n == 0) return (archive_point){tier->min, tier->sum / tier->n, tier->max};
+        n--;
+    }
+    return tier->points[(tier->head - 1 - n + tier->len) % tier->len];
+}
+
+void display_archive(archive_struct *archive, int zoom, int style, const char *label){
+    archive_tier *tier;
+    int cells = terminal_width() - CHART_LABEL_WIDTH - 1, shown;
+    double lowest = 0.0, highest = 0.0;
+    int seen = 0;
+    char title[MAX_LEN];
+
+    if(zoom < 0 || zoom >= ARCHIVE_TIERS) zoom = ARCHIVE_RAW;
+    tier = &archive->tiers[zoom];
+    shown = tier->count + (tier->n > 0);
+
+    if(cells < 1) cells = 1;
+    if(cells > CHART_MAX_WIDTH) cells = CHART_MAX_WIDTH;
+    if(shown > cells * (style == CHART_BRAILLE ? 2 : 1)) shown = cells * (style == CHART_BRAILLE ? 2 : 1); //only what fits on screen is copied
+
+    archive->view.head = archive->view.count = 0; //the view keeps its scale, only its samples are replaced
+    for(int n=shown - 1; n>=0; n--){ //oldest first, so the newest point ends up on the right
+        archive_point point = tier_at(tier, n);
+
+        if(!isnan(point.avg)){ //gaps are drawn empty and have no extremes
+            if(!seen || point.min < lowest) lowest = point.min;
+            if(!seen || point.max > highest) highest = point.max;
+            seen = 1;
+        }
+        chart_push(&archive->view, point.avg);
+    }
+
+    if(tier->period_ms > 0 && seen) //rollups also report the extremes their averages smooth over
+        snprintf(title, sizeof(title), "%s, %s (min %.2f / max %.2f), newest on the right", label, zoom_labels[zoom], lowest, highest);
+    else
+        snprintf(title, sizeof(title), "%s, %s, newest on the right", label, zoom_labels[zoom]);
+
+    display_chart(&archive->view, style, title);
+}
+
+const char *archive_zoom_name(int zoom){
+    return (zoom >= 0 && zoom < ARCHIVE_TIERS) ? zoom_names[zoom] : zoom_names[ARCHIVE_RAW];
+}
+
+void archive_free(archive_struct *archive){
+    free(archive->storage);
+    archive->storage = NULL;
+}
@@ -0,0 +1,148 @@
+#include "a3.h"
+
+// Charts draw the newest samples of a series (memory or cpu usage) across the width of the terminal.
+// Every glyph is taken from a table built once, so a frame is a sequence of memcpy calls into one buffer
+// and costs O(width) no matter how many samples have been taken.
+
+// sparkline glyphs, from an empty cell to a full block, each with its length in bytes
+static const char spark_glyphs[9][4] = {" ", "▁", "▂", "▃", "▄", "▅", "▆", "▇", "█"};
+static const int spark_len[9] = {1, 3, 3, 3, 3, 3, 3, 3, 3};
+
+// braille glyphs indexed by the number of dots lit (bottom up) in the left and right column of a cell
+static char braille_glyphs[5][5][4];
+static int braille_ready = 0;
+
+// builds the braille glyph table, encoding each code point U+2800..U+28FF as 3 bytes of UTF-8
+static void build_braille_glyphs(void){
+    const int left[5] = {0x00, 0x40, 0x44, 0x46, 0x47}; // dots 7, 3, 2, 1 lit from the bottom up
+    const int right[5] = {0x00, 0x80, 0xA0, 0xB0, 0xB8}; // dots 8, 6, 5, 4 lit from the bottom up
+
+    for(int l=0; l<5; l++){
+        for(int r=0; r<5; r++){
+            int code = 0x2800 | left[l] | right[r];
+            braille_glyphs[l][r][0] = (char)(0xE0 | (code >> 12));
+            braille_glyphs[l][r][1] = (char)(0x80 | ((code >> 6) & 0x3F));
+            braille_glyphs[l][r][2] = (char)(0x80 | (code & 0x3F));
+            braille_glyphs[l][r][3] = '\0';
+        }
+    }
+    braille_ready = 1;
+}
+
+void chart_init(chart_struct *chart, double lo, double hi){
+    chart->head = 0;
+    chart->count = 0;
+    chart->lo = lo;
+    chart->hi = hi;
+    chart->frame[0] = '\0';
+
+    if(!braille_ready) build_braille_glyphs();
+}
+
+void chart_push(chart_struct *chart, double value){
+    chart->values[chart->head] = value; //overwrites the oldest sample once the ring is full
+    chart->head = (chart->head + 1) % CHART_HISTORY;
+    if(chart->count < CHART_HISTORY) chart->count++;
+}
+
+// returns the n-th newest sample of the chart (0 being the newest)
+static double chart_at(chart_struct *chart, int n){
+    return chart->values[(chart->head - 1 - n + CHART_HISTORY) % CHART_HISTORY];
+}
+
+// maps a sample to the number of levels lit out of 'levels', lighting at least one level for any sample and none for a gap (NaN)
+static int chart_level(double value, double lo, double hi, int levels){
+    double frac = (value - lo) / (hi - lo);
+
+    if(isnan(value)) return 0;
+    if(!(frac > 0.0)) frac = 0.0;
+    if(frac > 1.0) frac = 1.0;
+
+    return 1 + (int)(frac * (levels - 1) + 0.5);
+}
+
+size_t chart_render(chart_struct *chart, int style, int width, const char *label){
+    int per_cell = (style == CHART_BRAILLE) ? 2 : 1; //braille packs two samples into every cell
+    int per_row = (style == CHART_BRAILLE) ? 4 : 8; //levels a single row of the chart can show
+    int cells = width - CHART_LABEL_WIDTH - 1;
+    int shown, levels[CHART_MAX_WIDTH * 2];
+    double lo = chart->lo, hi = chart->hi;
+    char *out = chart->frame;
+
+    if(cells < 1) cells = 1;
+    if(cells > CHART_MAX_WIDTH) cells = CHART_MAX_WIDTH;
+
+    shown = cells * per_cell;
+    if(shown > chart->count) shown = chart->count;
+
+    if(hi <= lo){ //auto-scale to the samples that are visible, leaving out the gaps
+        int seen = 0;
+
+        lo = hi = 0.0;
+        for(int n=0; n<shown; n++){
+            double v = chart_at(chart, n);
+
+            if(isnan(v)) continue;
+            if(!seen || v < lo) lo = v;
+            if(!seen || v > hi) hi = v;
+            seen = 1;
+        }
+        if(hi - lo < 0.01){ //a flat series is drawn around the middle of the chart
+            lo -= 0.5;
+            hi += 0.5;
+        }
+    }
+
+    // levels[] holds one entry per sample slot of the frame, oldest on the left and 0 for empty slots
+    for(int s=0; s<cells * per_cell; s++){
+        int n = cells * per_cell - 1 - s;
+        levels[s] = (n < shown) ? chart_level(chart_at(chart, n), lo, hi, CHART_HEIGHT * per_row) : 0;
+    }
+
+    out += snprintf(out, MAX_LEN, " %s\n", label);
+
+    for(int row=0; row<CHART_HEIGHT; row++){
+        int base = (CHART_HEIGHT - 1 - row) * per_row; //levels below this row
+
+        if(row == 0)
+            out += snprintf(out, 32, "%*.2f |", CHART_LABEL_WIDTH - 2, hi);
+        else if(row == CHART_HEIGHT - 1)
+            out += snprintf(out, 32, "%*.2f |", CHART_LABEL_WIDTH - 2, lo);
+        else
+            out += snprintf(out, 32, "%*s |", CHART_LABEL_WIDTH - 2, "");
+
+        for(int c=0; c<cells; c++){
+            if(style == CHART_BRAILLE){
+                int l = levels[2 * c] - base, r = levels[2 * c + 1] - base;
+                l = l < 0 ? 0 : (l > 4 ? 4 : l);
+                r = r < 0 ? 0 : (r > 4 ? 4 : r);
+                memcpy(out, braille_glyphs[l][r], 3);
+                out += 3;
+            } else {
+                int g = levels[c] - base;
+                g = g < 0 ? 0 : (g > 8 ? 8 : g);
+                memcpy(out, spark_glyphs[g], spark_len[g]);
+                out += spark_len[g];
+            }
+        }
+        *out++ = '\n';
+    }
+    *out = '\0';
+
+    return out - chart->frame;
+}
+
+void display_chart(chart_struct *chart, int style, const char *label){
+    size_t len = chart_render(chart, style, terminal_width(), label);
+    fwrite(chart->frame, 1, len, stdout); //the whole frame goes out in a single write
+}
+
+int terminal_width(void){
+    struct winsize ws; //a struct of type winsize found in <sys/ioctl.h>
+    char *columns = getenv("COLUMNS");
+
+    if(ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0) return ws.ws_col;
+    if(columns != NULL && atoi(columns) > 0) return atoi(columns);
+
+    return 80;
+}
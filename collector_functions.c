@@ -0,0 +1,650 @@
+#include "a3.h"
+
+// The registry holds every metric the monitor reports as a collector with a fixed set of hooks, so a new metric is
+// added by writing its hooks and registering it, without touching the sampling loop. Each collector is sampled on
+// its own interval: the files of the collectors that are due are read in one reader batch, then every due collector
+// samples in its own child process (or in this process in low-overhead mode) and pipes its payload back. Frames are
+// rendered every tdelay seconds from the latest payload of each collector, however often it was sampled.
+
+long monotonic_ms(void){
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000L + now.tv_nsec / 1000000;
+}
+
+int registry_add(registry_struct *registry, collector *c){
+    if(registry->n >= REGISTRY_MAX) return -1; //every collector needs a bit of the reader group mask
+
+    registry->collectors[registry->n++] = c;
+    return 0;
+}
+
+collector *registry_find(registry_struct *registry, const char *name){
+    for(int k=0; k<registry->n; k++){
+        if(strcmp(registry->collectors[k]->name, name) == 0) return registry->collectors[k];
+    }
+    return NULL;
+}
+
+void registry_init(registry_struct *registry, reader_struct *reader, display_struct *display){
+    for(int k=0; k<registry->n; k++){
+        collector *c = registry->collectors[k];
+
+        if(!c->enabled) continue;
+
+        c->group = 1u << k;
+        reader->group = c->group; //every file the collector adds is read only when the collector is due
+        if(c->init(c, reader, display) < 0) c->enabled = 0;
+
+        if(c->interval_ms <= 0) c->interval_ms = display->tdelay * 1000; //defaults to one sample per frame
+    }
+
+    reader->group = READER_ALL_GROUPS;
+}
+
+void registry_start(registry_struct *registry, reader_struct *reader, long now){
+    unsigned groups = 0;
+
+    for(int k=0; k<registry->n; k++){
+        if(registry->collectors[k]->enabled) groups |= registry->collectors[k]->group;
+    }
+
+    reader_submit(reader, groups); //the first sample only provides what the next ones are measured against
+
+    for(int k=0; k<registry->n; k++){
+        collector *c = registry->collectors[k];
+
+        if(!c->enabled) continue;
+        c->sample(c, reader);
+        c->next_ms = now + c->interval_ms;
+    }
+}
+
+static void *scratch = NULL; //payloads are received here first, so a partial one never overwrites the last good one
+static size_t scratch_cap = 0;
+
+// runs the sample hook of every collector in 'due' in its own child process, reads each payload back from a pipe,
+// and returns the groups of the collectors whose payload arrived whole
+static unsigned registry_fork(registry_struct *registry, reader_struct *reader, unsigned due){
+    int pipes[REGISTRY_MAX][2];
+    pid_t pids[REGISTRY_MAX];
+    unsigned received = 0;
+
+    fflush(stdout); //otherwise every child process would flush a copy of what is still buffered
+
+    for(int k=0; k<registry->n; k++){
+        collector *c = registry->collectors[k];
+
+        if(!(c->group & due)) continue;
+
+        if(pipe(pipes[k]) == -1){ //if pipe fails, an error message is printed and the program exits
+            fprintf(stderr, "Pipe Failed\n");
+            exit(1);
+        }
+
+        if((pids[k] = fork()) < 0){
+            fprintf(stderr, "Fork Failed\n");
+            exit(2);
+        } else if(pids[k] == 0){
+            // This is the collector's child process
+            signal(SIGINT, SIG_DFL); // Reset signal handler for SIGINT in child process
+            close(pipes[k][0]); //close the read end of the pipe
+
+            c->sample(c, reader); //samples from the buffers the reader filled before the fork
+            if(c->payload_len > c->payload_cap) c->payload_len = c->payload_cap;
+            write_all(pipes[k][1], &c->payload_len, sizeof(c->payload_len)); //the payload length first, then the payload
+            write_all(pipes[k][1], c->payload, c->payload_len);
+
+            close(pipes[k][1]); //close the write end of the pipe
+            exit(0); //exit the child process
+        }
+
+        close(pipes[k][1]); //close the write end of the pipe
+    }
+
+    // This is the main (parent) process
+    for(int k=0; k<registry->n; k++){
+        collector *c = registry->collectors[k];
+        size_t len = 0;
+
+        if(!(c->group & due)) continue;
+
+        if(c->payload_cap > scratch_cap){
+            if((scratch = realloc(scratch, c->payload_cap)) == NULL){
+                perror("realloc");
+                exit(1);
+            }
+            scratch_cap = c->payload_cap;
+        }
+
+        //the payload is read before waiting, so a child whose payload is larger than the pipe buffer can finish
+        if(read_all(pipes[k][0], &len, sizeof(len)) == sizeof(len) && len <= c->payload_cap
+            && (size_t)read_all(pipes[k][0], scratch, len) == len){
+            memcpy(c->payload, scratch, len);
+            c->payload_len = len;
+            received |= c->group;
+        } else {
+            fprintf(stderr, "%s: no sample received from child process\n", c->name); //the previous payload is kept
+        }
+
+        close(pipes[k][0]); //close the read end of the pipe
+        while(waitpid(pids[k], NULL, 0) == -1 && errno == EINTR); //retried, or the child would be left a zombie
+    }
+
+    return received;
+}
+
+int registry_sample(registry_struct *registry, reader_struct *reader, display_struct *display, long now, int fork_mode){
+    unsigned due = 0, received;
+    int sampled = 0;
+
+    for(int k=0; k<registry->n; k++){
+        collector *c = registry->collectors[k];
+        if(c->enabled && c->next_ms <= now) due |= c->group;
+    }
+
+    if(due == 0) return 0;
+
+    reader_submit(reader, due); //reads the files of every due collector in one batch, before any child process is forked
+
+    received = fork_mode ? registry_fork(registry, reader, due) : due;
+
+    for(int k=0; k<registry->n; k++){
+        collector *c = registry->collectors[k];
+
+        if(!(c->group & due)) continue;
+
+        if(!fork_mode) c->sample(c, reader); //low-overhead mode samples in this process, without forking or piping
+        if(c->record && (c->group & received)) c->record(c, display, now); //a collector whose payload was lost skips this sample
+
+        c->next_ms += c->interval_ms;
+        if(c->next_ms <= now) c->next_ms = now + c->interval_ms; //skips the samples missed while the monitor was stopped
+        sampled++;
+    }
+
+    return sampled;
+}
+
+long registry_next(registry_struct *registry){
+    long next = LONG_MAX;
+
+    for(int k=0; k<registry->n; k++){
+        if(registry->collectors[k]->enabled && registry->collectors[k]->next_ms < next) next = registry->collectors[k]->next_ms;
+    }
+    return next;
+}
+
+void registry_lower_rate(registry_struct *registry){
+    for(int k=0; k<registry->n; k++){
+        collector *c = registry->collectors[k];
+        c->interval_ms = (c->interval_ms > 0) ? c->interval_ms * 2 : 1000; //the same rule overhead_check applies to tdelay
+    }
+}
+
+void registry_render(registry_struct *registry, display_struct *display){
+    for(int k=0; k<registry->n; k++){
+        if(registry->collectors[k]->enabled) registry->collectors[k]->render(registry->collectors[k], display);
+    }
+}
+
+void registry_encode(registry_struct *registry, display_struct *display){
+    char buf[MAX_LEN];
+
+    for(int k=0; k<registry->n; k++){
+        collector *c = registry->collectors[k];
+
+        if(!c->enabled) continue;
+        c->encode(c, buf, sizeof(buf));
+        //frame index, collector name, its key=value fields, then how often it is really sampled (an interval of 0 follows tdelay)
+        printf("%d %s %s interval_ms=%ld lowered=%d\n", display->i, c->name, buf,
+            c->interval_ms > 0 ? (long)c->interval_ms : display->tdelay * 1000L, display->lowered);
+    }
+    fflush(stdout);
+}
+
+void registry_teardown(registry_struct *registry){
+    for(int k=0; k<registry->n; k++){
+        if(registry->collectors[k]->enabled) registry->collectors[k]->teardown(registry->collectors[k]);
+    }
+    free(scratch);
+    scratch = NULL;
+    scratch_cap = 0;
+}
+
+/*###############################################################################################*/
+
+static int memory_init(collector *c, reader_struct *reader, display_struct *display){
+    memory_state *state = (memory_state *)calloc(1, sizeof(memory_state));
+
+    if(state == NULL || (c->payload = calloc(1, sizeof(mem_struct))) == NULL){
+        perror("calloc");
+        exit(1);
+    }
+
+    state->meminfo_slot = reader_add(reader, "/proc/meminfo", PROC_FILE_LEN);
+    archive_init(&state->archive, 0.0, 0.0); //virtual memory auto-scales to the samples on screen
+
+    c->state = state;
+    c->payload_cap = c->payload_len = sizeof(mem_struct);
+    return 0;
+}
+
+static void memory_sample(collector *c, reader_struct *reader){
+    memory_state *state = c->state;
+    write_memory(c->payload, reader_data(reader, state->meminfo_slot));
+}
+
+static void memory_record(collector *c, display_struct *display, long now){
+    memory_state *state = c->state;
+    if(display->graphics) archive_push(&state->archive, now, ((mem_struct *)c->payload)->virt_used); //folds the virtual memory used into its history
+}
+
+static int memory_encode(collector *c, char *buf, size_t size){
+    mem_struct *mem = c->payload;
+    return snprintf(buf, size, "phys_used_gb=%.2f phys_total_gb=%.2f virt_used_gb=%.2f virt_total_gb=%.2f",
+        mem->phys_used, mem->phys_total, mem->virt_used, mem->virt_total);
+}
+
+static void memory_render(collector *c, display_struct *display){
+    memory_state *state = c->state;
+    mem_struct *mem = c->payload;
+    char *line = state->lines[display->i % MEM_LINES_MAX];
+    int rows = (display->samples > 0 && display->samples < MEM_LINES_MAX) ? display->samples : MEM_LINES_MAX;
+
+    printf("---------------------------------------\n");
+
+    strcpy(line, mem->mem_str); //the line of this frame, kept for the frames after it
+    if(display->graphics){
+        modify_memory_graphics(display->i, mem->virt_used, &state->prev_virt, line); //modify the line graphically if graphics is an option
+        rows = 1; //the chart below carries the history, so only the line of this frame is shown
+    }
+
+    display_memory_line(display->sequential, display->samples, rows, display->i, state->lines); //displays lines of memory information according to sequential
+
+    if(display->graphics)
+        display_archive(&state->archive, display->zoom, display->chart_style, "virtual memory used (GB)"); //draws the memory history at the zoom level, scaled to the terminal width
+}
+
+static void memory_teardown(collector *c){
+    memory_state *state = c->state;
+
+    archive_free(&state->archive);
+    free(state);
+    free(c->payload);
+}
+
+collector memory_collector = {"memory", 0, 1, memory_init, memory_sample, memory_record, memory_encode, memory_render, memory_teardown};
+
+/*###############################################################################################*/
+
+static int vmstat_init(collector *c, reader_struct *reader, display_struct *display){
+    vmstat_state *state = (vmstat_state *)calloc(1, sizeof(vmstat_state));
+
+    if(state == NULL || (c->payload = calloc(1, sizeof(vmstat_payload))) == NULL){
+        perror("calloc");
+        exit(1);
+    }
+
+    if((state->vmstat_slot = reader_add(reader, "/proc/vmstat", PROC_FILE_LEN)) < 0){ //kernels without /proc/vmstat have no paging counters
+        free(state);
+        free(c->payload);
+        return -1;
+    }
+
+    c->state = state;
+    c->payload_cap = c->payload_len = sizeof(vmstat_payload);
+    return 0;
+}
+
+static void vmstat_sample(collector *c, reader_struct *reader){
+    vmstat_state *state = c->state;
+    vmstat_payload *payload = c->payload;
+    unsigned long long values[VMSTAT_COUNTERS];
+    long now = monotonic_ms();
+
+    payload->present = vmstat_parse(reader_data(reader, state->vmstat_slot), values);
+    for(int k=0; k<VMSTAT_COUNTERS; k++){
+        if(!(payload->present & (1u << k))){ //a counter that was not read keeps its last value, so the next rate does not spike
+            payload->delta[k] = 0;
+            continue;
+        }
+        payload->delta[k] = (values[k] >= payload->last[k]) ? values[k] - payload->last[k] : 0; //measured against the last sample, whichever process took it
+        payload->last[k] = values[k];
+    }
+
+    if(payload->present == 0) return; //a failed read skips this interval, the next rate is measured from the last good sample
+    payload->elapsed_ms = now - payload->sampled_ms;
+    payload->sampled_ms = now;
+}
+
+static int vmstat_encode(collector *c, char *buf, size_t size){
+    vmstat_payload *payload = c->payload;
+
+    if(payload->present == 0) return snprintf(buf, size, "skipped=1"); //no rate for an interval /proc/vmstat could not be read in
+    return snprintf(buf, size, "pgfault_per_sec=%.0f pgmajfault_per_sec=%.0f pswpin_per_sec=%.0f pswpout_per_sec=%.0f "
+        "pgscan_per_sec=%.0f pgsteal_per_sec=%.0f oom_kill=%llu", vmstat_rate(payload, VMSTAT_PGFAULT),
+        vmstat_rate(payload, VMSTAT_PGMAJFAULT), vmstat_rate(payload, VMSTAT_PSWPIN), vmstat_rate(payload, VMSTAT_PSWPOUT),
+        vmstat_rate(payload, VMSTAT_PGSCAN), vmstat_rate(payload, VMSTAT_PGSTEAL), payload->delta[VMSTAT_OOM_KILL]);
+}
+
+static void vmstat_render(collector *c, display_struct *display){
+    print_vmstat(c->payload); //registered right after the memory collector, so the rates appear under the memory lines
+}
+
+static void vmstat_teardown(collector *c){
+    free(c->state);
+    free(c->payload);
+}
+
+collector vmstat_collector = {"vmstat", 0, 1, vmstat_init, vmstat_sample, NULL, vmstat_encode, vmstat_render, vmstat_teardown};
+
+/*###############################################################################################*/
+
+static int users_init(collector *c, reader_struct *reader, display_struct *display){
+    users_state *state = (users_state *)calloc(1, sizeof(users_state));
+    struct stat st;
+
+    if(state == NULL){
+        perror("calloc");
+        exit(1);
+    }
+
+    state->utmp_cap = UTMP_FILE_LEN;
+    if(stat(_PATH_UTMP, &st) == 0 && (size_t)st.st_size * 2 > state->utmp_cap) //room for the database to double while the monitor runs
+        state->utmp_cap = (st.st_size * 2 / sizeof(struct utmp) + 1) * sizeof(struct utmp);
+
+    state->utmp_slot = reader_add(reader, _PATH_UTMP, state->utmp_cap); //-1 when there is no utmp database, which reports no users
+
+    c->state = state;
+    c->payload_cap = sizeof(users_payload) + state->utmp_cap;
+    if((c->payload = calloc(1, c->payload_cap)) == NULL){
+        perror("calloc");
+        exit(1);
+    }
+    c->payload_len = sizeof(users_payload);
+    return 0;
+}
+
+// keeps only the records of users currently logged in, so the payload piped back is as small as it can be
+static void users_sample(collector *c, reader_struct *reader){
+    users_state *state = c->state;
+    users_payload *payload = c->payload;
+    const char *utmp = reader_data(reader, state->utmp_slot);
+    ssize_t utmp_len = reader_len(reader, state->utmp_slot);
+
+    payload->n_records = 0;
+    payload->truncated = (utmp != NULL && (size_t)utmp_len >= state->utmp_cap); //a full slot means the database may go on past it
+    for(ssize_t off = 0; utmp != NULL && off + (ssize_t)sizeof(struct utmp) <= utmp_len; off += sizeof(struct utmp)){
+        if(user_record(utmp, off, &payload->records[payload->n_records])) payload->n_records++; //a record of no user is overwritten by the next one
+    }
+    c->payload_len = sizeof(users_payload) + payload->n_records * sizeof(struct utmp);
+}
+
+static int users_encode(collector *c, char *buf, size_t size){
+    users_payload *payload = c->payload;
+    int len = snprintf(buf, size, "sessions=%d truncated=%d", payload->n_records, payload->truncated);
+
+    for(int r = 0; r < payload->n_records && len < (int)size; r++){
+        len += snprintf(buf + len, size - len, "%s%.*s", r ? "," : " users=", UT_NAMESIZE, payload->records[r].ut_user);
+    }
+    return len;
+}
+
+static void users_render(collector *c, display_struct *display){
+    users_payload *payload = c->payload;
+    users *user_queue = read_users((const char *)payload->records, payload->n_records * sizeof(struct utmp));
+
+    printf("---------------------------------------\n");
+    if(display->show_system)
+        printf("### Sessions/users ###\n"); //prints a header when the users are shown between memory and cpu
+    print_users(user_queue); //prints current user information on server
+    if(payload->truncated)
+        printf(" (the utmp database outgrew the %zu bytes read, later sessions are not shown)\n", ((users_state *)c->state)->utmp_cap);
+    printf("---------------------------------------\n");
+
+    delete_users(user_queue); //deletes the user queue
+}
+
+static void users_teardown(collector *c){
+    free(c->state);
+    free(c->payload);
+}
+
+collector users_collector = {"users", 0, 1, users_init, users_sample, NULL, users_encode, users_render, users_teardown};
+
+/*###############################################################################################*/
+
+static int cpu_init(collector *c, reader_struct *reader, display_struct *display){
+    cpu_state *state = (cpu_state *)calloc(1, sizeof(cpu_state));
+
+    if(state == NULL){
+        perror("calloc");
+        exit(1);
+    }
+
+    state->stat_slot = reader_add(reader, "/proc/stat", PROC_FILE_LEN);
+    thermal_open(&state->thermal, reader);
+    archive_init(&state->archive, 0.0, 100.0); //cpu usage is always drawn on a 0-100% scale
+
+    c->payload_cap = c->payload_len = sizeof(cpu_payload) + state->thermal.n_values * sizeof(long);
+    c->payload = calloc(1, c->payload_cap);
+    state->thermal_prev = (long *)calloc(state->thermal.n_values + 1, sizeof(long)); //+1 so a machine without any of them still gets a valid array
+
+    if(c->payload == NULL || state->thermal_prev == NULL){
+        perror("calloc");
+        exit(1);
+    }
+
+    c->state = state;
+    return 0;
+}
+
+static void cpu_sample(collector *c, reader_struct *reader){
+    cpu_state *state = c->state;
+    cpu_payload *payload = c->payload;
+    cpu_struct cur;
+
+    set_cpu_values(&cur, reader_data(reader, state->stat_slot));
+    payload->usage = calculate_cpu_usage(&payload->last, &cur); //measured against the last sample, whichever process took it
+    payload->last = cur;
+
+    thermal_read(&state->thermal, reader, payload->thermal); //parses the frequency/thermal files the reader read
+}
+
+static void cpu_record(collector *c, display_struct *display, long now){
+    cpu_state *state = c->state;
+    if(display->graphics) archive_push(&state->archive, now, ((cpu_payload *)c->payload)->usage); //O(1), every tier is a fixed ring
+}
+
+static int cpu_encode(collector *c, char *buf, size_t size){
+    cpu_state *state = c->state;
+    cpu_payload *payload = c->payload;
+    long *values = payload->thermal, freq_sum = 0, n_freq = 0, temp_max = -1;
+    int n = state->thermal.n_cores, len;
+
+    len = snprintf(buf, size, "usage_pct=%.2f cores=%ld", payload->usage, sysconf(_SC_NPROCESSORS_ONLN));
+
+    for(int k=0; k<n; k++){
+        if(values[k] >= 0){
+            freq_sum += values[k];
+            n_freq++;
+        }
+    }
+    for(int z=0; z<state->thermal.n_zones; z++){
+        if(values[2 * n + state->thermal.n_packages + z] > temp_max) temp_max = values[2 * n + state->thermal.n_packages + z];
+    }
+
+    if(n_freq > 0 && len < (int)size) len += snprintf(buf + len, size - len, " freq_avg_mhz=%ld", freq_sum / n_freq / 1000);
+    if(temp_max >= 0 && len < (int)size) len += snprintf(buf + len, size - len, " temp_max_c=%.1f", temp_max / 1000.0);
+    return len;
+}
+
+static void cpu_render(collector *c, display_struct *display){
+    cpu_state *state = c->state;
+    cpu_payload *payload = c->payload;
+
+    print_cores(); //print the number of cores
+    print_thermal(&state->thermal, payload->thermal, state->thermal_prev, display->i); //print frequencies, throttling and temperatures next to the cores
+    memcpy(state->thermal_prev, payload->thermal, state->thermal.n_values * sizeof(long)); //the previous frame's values for the next throttle deltas
+
+    printf(" total cpu use: %.2f%%\n", payload->usage); //prints current cpu usage upto 2 decimal places
+
+    if(display->graphics)
+        cpu_graphics(&state->archive, display->chart_style, display->zoom); //if graphics option is given, display cpu graphics
+}
+
+static void cpu_teardown(collector *c){
+    cpu_state *state = c->state;
+
+    free(state->thermal_prev);
+    archive_free(&state->archive);
+    free(state);
+    free(c->payload);
+}
+
+collector cpu_collector = {"cpu", 0, 1, cpu_init, cpu_sample, cpu_record, cpu_encode, cpu_render, cpu_teardown};
+
+/*###############################################################################################*/
+
+// reads a whole /proc file once, before the reader starts, to learn its layout and size
+static char *read_text(const char *path, size_t *len){
+    size_t cap = 64 * 1024;
+    char *text = malloc(cap + 1);
+    ssize_t bytesRead = 0;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    *len = 0;
+    if(fd < 0 || text == NULL){
+        if(fd >= 0) close(fd);
+        free(text);
+        return NULL;
+    }
+
+    while((bytesRead = read(fd, text + *len, cap - *len)) > 0){
+        *len += bytesRead;
+        if(*len == cap){ //the file is larger than the buffer, which doubles
+            char *grown = realloc(text, 2 * cap + 1);
+
+            if(grown == NULL) break;
+            text = grown;
+            cap *= 2;
+        }
+    }
+    text[*len] = '\0';
+
+    close(fd);
+    return text;
+}
+
+// opens a matrix from the file at path and adds the file to the reader, returning the number of cells or -1
+static int irq_open(irq_matrix *matrix, reader_struct *reader, const char *path, int *slot){
+    size_t len;
+    char *text = read_text(path, &len);
+    int cells = (text != NULL) ? irq_matrix_open(matrix, text) : -1;
+
+    free(text);
+    if(cells < 0) return -1;
+
+    //counts are padded to a fixed width, so the file only grows with new rows; half as much again leaves room for them
+    *slot = reader_add(reader, path, len + len / 2 + 4096);
+    if(*slot < 0){
+        irq_matrix_close(matrix);
+        return -1;
+    }
+    return cells;
+}
+
+static int irq_init(collector *c, reader_struct *reader, display_struct *display){
+    irq_state *state = (irq_state *)calloc(1, sizeof(irq_state));
+    int hard_cells, soft_cells;
+
+    if(state == NULL){
+        perror("calloc");
+        exit(1);
+    }
+
+    hard_cells = irq_open(&state->hard, reader, "/proc/interrupts", &state->hard_slot);
+    soft_cells = irq_open(&state->soft, reader, "/proc/softirqs", &state->soft_slot);
+
+    if(hard_cells < 0 || soft_cells < 0){
+        fprintf(stderr, "irqs: cannot read /proc/interrupts and /proc/softirqs\n");
+        if(hard_cells >= 0) irq_matrix_close(&state->hard);
+        if(soft_cells >= 0) irq_matrix_close(&state->soft);
+        free(state);
+        return -1;
+    }
+
+    c->payload_cap = c->payload_len = sizeof(irq_payload) + (hard_cells + soft_cells) * sizeof(unsigned);
+    c->payload = calloc(1, c->payload_cap);
+    state->cur = (unsigned *)calloc(hard_cells + soft_cells + 1, sizeof(unsigned));
+    state->delta = (unsigned *)calloc(hard_cells + soft_cells + 1, sizeof(unsigned));
+
+    if(c->payload == NULL || state->cur == NULL || state->delta == NULL){
+        perror("calloc");
+        exit(1);
+    }
+
+    c->state = state;
+    return 0;
+}
+
+static void irq_sample(collector *c, reader_struct *reader){
+    irq_state *state = c->state;
+    irq_payload *payload = c->payload;
+    int hard_cells = state->hard.n_rows * state->hard.n_cpus, soft_cells = state->soft.n_rows * state->soft.n_cpus;
+    long now = monotonic_ms();
+
+    memcpy(state->cur, payload->counts, (hard_cells + soft_cells) * sizeof(unsigned)); //rows missing from this read keep their counts
+    irq_matrix_parse(&state->hard, reader_data(reader, state->hard_slot), state->cur);
+    irq_matrix_parse(&state->soft, reader_data(reader, state->soft_slot), state->cur + hard_cells);
+
+    payload->hard_total = irq_matrix_delta(state->cur, payload->counts, state->delta, hard_cells);
+    payload->soft_total = irq_matrix_delta(state->cur + hard_cells, payload->counts + hard_cells, state->delta + hard_cells, soft_cells);
+    payload->n_hard_top = irq_matrix_hottest(&state->hard, state->delta, payload->hard_top, IRQ_TOP);
+    payload->n_soft_top = irq_matrix_hottest(&state->soft, state->delta + hard_cells, payload->soft_top, IRQ_TOP);
+
+    memcpy(payload->counts, state->cur, (hard_cells + soft_cells) * sizeof(unsigned)); //what the next deltas are measured against
+    payload->elapsed_ms = now - payload->sampled_ms;
+    payload->sampled_ms = now;
+}
+
+static int irq_encode(collector *c, char *buf, size_t size){
+    irq_state *state = c->state;
+    irq_payload *payload = c->payload;
+    double seconds = (payload->elapsed_ms > 0) ? payload->elapsed_ms / 1000.0 : 1.0;
+    int len = snprintf(buf, size, "irqs_per_sec=%.0f softirqs_per_sec=%.0f", payload->hard_total / seconds, payload->soft_total / seconds);
+
+    if(payload->n_hard_top > 0 && len < (int)size){ //the hottest cell of each matrix, as NAME@cpuN:RATE
+        irq_cell *top = &payload->hard_top[0];
+        len += snprintf(buf + len, size - len, " top_irq=%s@cpu%d:%.0f", state->hard.names[top->row], state->hard.cpu_ids[top->col], top->delta / seconds);
+    }
+    if(payload->n_soft_top > 0 && len < (int)size){
+        irq_cell *top = &payload->soft_top[0];
+        len += snprintf(buf + len, size - len, " top_softirq=%s@cpu%d:%.0f", state->soft.names[top->row], state->soft.cpu_ids[top->col], top->delta / seconds);
+    }
+    return len;
+}
+
+static void irq_render(collector *c, display_struct *display){
+    irq_state *state = c->state;
+    irq_payload *payload = c->payload;
+
+    printf("---------------------------------------\n");
+    printf("### Interrupts ### (cpu, IRQ, rate, handler)\n"); //prints a header
+    print_irqs(&state->hard, "IRQs", payload->hard_top, payload->n_hard_top, payload->hard_total, payload->elapsed_ms);
+    print_irqs(&state->soft, "softirqs", payload->soft_top, payload->n_soft_top, payload->soft_total, payload->elapsed_ms);
+}
+
+static void irq_teardown(collector *c){
+    irq_state *state = c->state;
+
+    irq_matrix_close(&state->hard);
+    irq_matrix_close(&state->soft);
+    free(state->cur);
+    free(state->delta);
+    free(state);
+    free(c->payload);
+}
+
+collector irq_collector = {"irqs", 0, 0, irq_init, irq_sample, NULL, irq_encode, irq_render, irq_teardown}; //off unless --irqs is given
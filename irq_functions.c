@@ -0,0 +1,210 @@
+#include "a3.h"
+
+// /proc/interrupts and /proc/softirqs are matrices with one row per IRQ and one column per online cpu, which run to
+// hundreds of kilobytes on hosts with hundreds of cores. Their layout is learned once when a matrix is opened; every
+// sample then parses the counts in a single pass with no allocation, expecting each row where it was last time, and
+// the deltas and the hottest cells are found with vector operations over the flat arrays of counts.
+
+// 4 counts, and 4 sums of counts, per vector operation (GCC vector extensions, lowered to SSE/NEON or plain code)
+typedef unsigned irq_vec __attribute__((vector_size(4 * sizeof(unsigned))));
+typedef unsigned long long irq_wide __attribute__((vector_size(4 * sizeof(unsigned long long))));
+
+// returns a pointer to the first character of the next line, or to the terminating NUL
+static const char *next_line(const char *p){
+    while(*p != '\0' && *p != '\n') p++;
+    return (*p == '\n') ? p + 1 : p;
+}
+
+// parses the row label of a line (what precedes the ':'), returning a pointer past the ':' or NULL if there is none
+static const char *row_label(const char *p, const char **label, int *len){
+    while(*p == ' ') p++;
+    *label = p;
+    while(*p != ':' && *p != '\n' && *p != '\0') p++;
+    if(*p != ':') return NULL;
+
+    *len = p - *label;
+    return p + 1;
+}
+
+// copies the text after the counts of a line into desc: the handler (last word) of a numbered IRQ, the whole
+// description with its runs of spaces collapsed for a named one
+static void row_desc(const char *p, const char *label, char desc[IRQ_DESC_LEN]){
+    const char *end = p, *last = p;
+    int len = 0;
+
+    while(*end != '\n' && *end != '\0'){
+        if(*end != ' ' && (end == p || end[-1] == ' ')) last = end; //start of the last word
+        end++;
+    }
+
+    if(*label >= '0' && *label <= '9') p = last;
+    while(*p == ' ') p++;
+
+    for(; p < end && len < IRQ_DESC_LEN - 1; p++){
+        if(*p == ' ' && (len == 0 || desc[len - 1] == ' ')) continue;
+        desc[len++] = *p;
+    }
+    while(len > 0 && desc[len - 1] == ' ') len--;
+    desc[len] = '\0';
+}
+
+// skips the counts of a line, at most n_cpus of them (lines such as ERR: and MIS: only have one)
+static const char *skip_counts(const char *p, int n_cpus){
+    for(int col=0; col<n_cpus; col++){
+        while(*p == ' ') p++;
+        if(*p < '0' || *p > '9') break;
+        while(*p >= '0' && *p <= '9') p++;
+    }
+    return p;
+}
+
+int irq_matrix_open(irq_matrix *matrix, const char *text){
+    const char *p = text, *label;
+    int rows = 0, len;
+
+    memset(matrix, 0, sizeof(*matrix));
+
+    for(const char *q = text; *q != '\0' && *q != '\n'; q++){ //the header names one column per online cpu
+        if(q[0] == 'C' && q[1] == 'P' && q[2] == 'U') matrix->n_cpus++;
+    }
+    if(matrix->n_cpus == 0) return -1;
+
+    for(p = next_line(text); *p != '\0'; p = next_line(p)) rows++; //one row per line, so the matrix holds every IRQ however many queues a device has
+
+    matrix->cpu_ids = (int *)calloc(matrix->n_cpus, sizeof(int));
+    matrix->names = calloc(rows + 1, sizeof(*matrix->names));
+    matrix->descs = calloc(rows + 1, sizeof(*matrix->descs));
+
+    if(matrix->cpu_ids == NULL || matrix->names == NULL || matrix->descs == NULL){
+        perror("calloc");
+        exit(1);
+    }
+
+    p = text;
+    for(int col=0; col<matrix->n_cpus; col++){
+        p = strstr(p, "CPU") + 3;
+        matrix->cpu_ids[col] = atoi(p);
+    }
+
+    for(p = next_line(text); *p != '\0' && matrix->n_rows < rows; p = next_line(p)){
+        const char *counts = row_label(p, &label, &len);
+
+        if(counts == NULL) continue;
+        if(len >= IRQ_NAME_LEN) len = IRQ_NAME_LEN - 1;
+
+        memcpy(matrix->names[matrix->n_rows], label, len);
+        matrix->names[matrix->n_rows][len] = '\0';
+        row_desc(skip_counts(counts, matrix->n_cpus), label, matrix->descs[matrix->n_rows]);
+        matrix->n_rows++;
+    }
+
+    return matrix->n_rows * matrix->n_cpus;
+}
+
+int irq_matrix_parse(irq_matrix *matrix, const char *text, unsigned *counts){
+    const char *p, *label;
+    int row = 0, parsed = 0, len;
+
+    if(text == NULL) return 0;
+
+    for(p = next_line(text); *p != '\0'; p = next_line(p)){
+        const char *q = row_label(p, &label, &len);
+        unsigned *cells;
+
+        if(q == NULL) continue;
+        if(len >= IRQ_NAME_LEN) len = IRQ_NAME_LEN - 1;
+
+        //rows keep their order, so the row after the previous one is checked before searching the whole matrix
+        if(row >= matrix->n_rows || strncmp(matrix->names[row], label, len) != 0 || matrix->names[row][len] != '\0'){
+            for(row = 0; row < matrix->n_rows; row++){
+                if(strncmp(matrix->names[row], label, len) == 0 && matrix->names[row][len] == '\0') break;
+            }
+            if(row == matrix->n_rows) continue; //an IRQ that appeared after the matrix was opened
+        }
+
+        cells = counts + row * matrix->n_cpus;
+        for(int col=0; col<matrix->n_cpus; col++){
+            unsigned value = 0;
+
+            while(*q == ' ') q++;
+            if(*q < '0' || *q > '9') break;
+            while(*q >= '0' && *q <= '9') value = value * 10 + (*q++ - '0');
+            cells[col] = value;
+        }
+
+        row++;
+        parsed++;
+    }
+
+    return parsed;
+}
+
+unsigned long irq_matrix_delta(const unsigned *cur, const unsigned *prev, unsigned *delta, int cells){
+    irq_wide sums = {0, 0, 0, 0};
+    unsigned long total = 0;
+    int k = 0;
+
+    for(; k + 4 <= cells; k += 4){
+        irq_vec a, b;
+
+        memcpy(&a, cur + k, sizeof(a)); //memcpy, as the arrays are only aligned for unsigned
+        memcpy(&b, prev + k, sizeof(b));
+        a -= b; //unsigned, so a counter that wrapped still gives the right delta
+        memcpy(delta + k, &a, sizeof(a));
+        sums += __builtin_convertvector(a, irq_wide); //summed in 64 bits so the total cannot wrap
+    }
+
+    for(; k < cells; k++){
+        delta[k] = cur[k] - prev[k];
+        total += delta[k];
+    }
+
+    return total + sums[0] + sums[1] + sums[2] + sums[3];
+}
+
+int irq_matrix_hottest(irq_matrix *matrix, const unsigned *delta, irq_cell *top, int k){
+    int cells = matrix->n_rows * matrix->n_cpus, found = 0;
+
+    for(int base = 0; base < cells; base += 4){
+        unsigned threshold = (found < k) ? 0 : top[k - 1].delta; //what a cell has to beat to make it into the top
+
+        if(base + 4 <= cells){ //most cells are idle, so a whole vector is skipped with one compare
+            irq_vec d, t = {threshold, threshold, threshold, threshold};
+
+            memcpy(&d, delta + base, sizeof(d));
+            d = (irq_vec)(d > t);
+            if((d[0] | d[1] | d[2] | d[3]) == 0) continue;
+        }
+
+        for(int cell = base; cell < base + 4 && cell < cells; cell++){
+            int pos;
+
+            if(delta[cell] <= ((found < k) ? 0 : top[k - 1].delta)) continue;
+
+            if(found < k) found++;
+            for(pos = found - 1; pos > 0 && top[pos - 1].delta < delta[cell]; pos--) top[pos] = top[pos - 1]; //insertion keeps top sorted
+            top[pos] = (irq_cell){cell / matrix->n_cpus, cell % matrix->n_cpus, delta[cell]};
+        }
+    }
+
+    return found;
+}
+
+//  prints the total rate of a matrix followed by its hottest cells
+void print_irqs(irq_matrix *matrix, const char *title, irq_cell *top, int n, unsigned long total, long elapsed_ms){
+    double seconds = (elapsed_ms > 0) ? elapsed_ms / 1000.0 : 1.0;
+
+    printf(" %s: %.0f/s across %d cpu%s%s\n", title, total / seconds, matrix->n_cpus, matrix->n_cpus == 1 ? "" : "s", n ? ", hottest:" : "");
+
+    for(int k=0; k<n; k++){
+        printf("  cpu%-4d %-10s %10.0f/s  %s\n", matrix->cpu_ids[top[k].col], matrix->names[top[k].row],
+            top[k].delta / seconds, matrix->descs[top[k].row]);
+    }
+}
+
+void irq_matrix_close(irq_matrix *matrix){
+    free(matrix->cpu_ids);
+    free(matrix->names);
+    free(matrix->descs);
+    memset(matrix, 0, sizeof(*matrix));
+}
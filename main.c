@@ -27,6 +27,15 @@ void sigtstp_handler(int sig) {
     return;
 }
 
+static volatile sig_atomic_t zoom = ARCHIVE_RAW; //archive tier the charts show, changed by --zoom and SIGUSR1
+
+/* Function to handle the SIGUSR1 signal. Takes a single parameter, 'sig' (representing the signal number).
+ * Switches the charts to the next zoom level (raw, minute, hour, then raw again), from the next frame on.
+ */
+void sigusr1_handler(int sig) {
+    zoom = (zoom + 1) % ARCHIVE_TIERS;
+}
+
 
 /* Main function, implementing the functionality to display memory, user, cpu usage of the system.
  * Takes two parameters, 'argc' (representing the number of arguments passed to the program) and
@@ -35,12 +44,17 @@ void sigtstp_handler(int sig) {
 int main(int argc, char *argv[]) {
 
     //initializing variables and flags used to control the display of information in the program
-    int i, samples = 10, tdelay = 1, system = 0, user = 0, graphics = 0, sequential = 0, cmd; 
-    int memory_pipe[2], users_pipe[2], cpu_pipe[2];
-    pid_t pid_memory=getpid(), pid_users=getpid(), pid_cpu=getpid();
-    users* user_queue = NULL;
+    int i, samples = 10, tdelay = 1, system = 0, user = 0, graphics = 0, sequential = 0, chart_style = CHART_SPARK, machine = 0, irqs = 0, cmd; 
+    int lowered = 0;
+    long now, next_frame, wake; //monotonic times in milliseconds
+    char *colon;
+    collector *c;
     struct sigaction sa;
-    cpu_struct prev_cpu_struct;
+    struct timespec wake_ts;
+    static reader_struct reader; //every file the collectors read, submitted as one batch per sample and inherited by every child process
+    static registry_struct registry; //every collector, in the order their sections are displayed
+    display_struct display;
+    overhead_struct overhead = {0, 0, OVERHEAD_DEFAULT_BUDGET}; //--low-overhead settings, off by default
 
     //uses getopt_long to parse the command line options passed to the program
     struct option long_options[] = { //an array of 'struct option' objects, each line representing a single command line option
@@ -50,14 +64,21 @@ int main(int argc, char *argv[]) {
         {"sequential", no_argument, 0, 'q'}, //takes "sequential" with no argument, returns 'q' if option is present
         {"samples", optional_argument, 0, 'n'}, //takes "samples" with optional argument, returns 'n' if option is present
         {"tdelay", optional_argument, 0, 't'}, //takes "tdelay" with optional argument, returns 't' if option is present
+        {"chart", required_argument, 0, 'c'}, //takes "chart" with a required argument (spark or braille), returns 'c' if option is present
+        {"low-overhead", optional_argument, 0, 'l'}, //takes "low-overhead" with optional argument (the housekeeping cpu), returns 'l' if option is present
+        {"budget", required_argument, 0, 'b'}, //takes "budget" with a required argument (percent of one cpu), returns 'b' if option is present
+        {"interval", required_argument, 0, 'i'}, //takes "interval" with a required argument (NAME:MS), returns 'i' if option is present
+        {"machine", no_argument, 0, 'm'}, //takes "machine" with no argument, returns 'm' if option is present
+        {"zoom", required_argument, 0, 'z'}, //takes "zoom" with a required argument (raw, minute or hour), returns 'z' if option is present
+        {"irqs", no_argument, 0, 'r'}, //takes "irqs" with no argument, returns 'r' if option is present
         {0,0,0,0} //indicates the end of options
     };
 
-    double virt_used=0.0, prev_virt=0.00; //declares and initializes variables for virtual current and previous memory usage
-    float cur_cpu_usage=0.00, prev_cpu_usage=0.00; //declares and initializes variables for current and previous cpu usage
-    char strArr[samples][1024]; //a 2D char array for storing memory display information
-    char cpuArr[samples][200]; //a 2D char array for storing cpu display information
-    int num_bar=3; //sets default num of bars for cpu graphics to 3
+    registry_add(&registry, &memory_collector); //the collectors are displayed in the order they are added
+    registry_add(&registry, &vmstat_collector);
+    registry_add(&registry, &users_collector);
+    registry_add(&registry, &cpu_collector);
+    registry_add(&registry, &irq_collector);
 
     sa.sa_handler = sigtstp_handler;
     sigemptyset(&sa.sa_mask);
@@ -68,13 +89,22 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    sa.sa_handler = sigusr1_handler;
+    sa.sa_flags = SA_RESTART; //a zoom change must not cut short the reads and waits of the sampling loop
+
+    if (sigaction(SIGUSR1, &sa, NULL) == -1) {
+        perror("sigaction");
+        return 1;
+    }
+
     //retrieves and processes command line options passed to the program using the 'getopt_long' function
     // stored in argv array, and returns the next option found in the argument list
     //loop continues until getopt_long returns -1, meaning all the options have been processed
 
-    while ((cmd=getopt_long(argc, argv, "sugqn::t::", long_options, NULL)) != -1){ 
-        //the string "sugqn::t::" specifies that he options -s, -u, -g, -q, -n and -t are available. 
-        //The (::) following the letters n and t indicate that an optional argument, which the user can specify by appending a value to the option on the command line
+    while ((cmd=getopt_long(argc, argv, "sugqn::t::c:l::b:i:mz:r", long_options, NULL)) != -1){ 
+        //the string "sugqn::t::c:l::b:i:mz:r" specifies that he options -s, -u, -g, -q, -n, -t, -c, -l, -b, -i, -m, -z and -r are available. 
+        //The (::) following the letters n, t and l indicate that an optional argument, which the user can specify by appending a value to the option on the command line
+        //The (:) following the letters c, b, i and z indicates that they require an argument
         
         switch (cmd) { //switch statment to determine action to take based on the option returned by getopt_long
             case 's':
@@ -97,6 +127,39 @@ int main(int argc, char *argv[]) {
                 //in case cmd is 't', if option has an argument, atoi converts the argument from string to integer and updates the value of tdelay 
                 if (optarg) tdelay = atoi(optarg); 
                 break;
+            case 'c':
+                //in case cmd is 'c', charts are drawn with braille dots if the argument is "braille" and with sparkline blocks otherwise
+                chart_style = (strcmp(optarg, "braille") == 0) ? CHART_BRAILLE : CHART_SPARK;
+                break;
+            case 'l':
+                //in case cmd is 'l', low-overhead mode is turned on, pinned to the cpu given as argument (cpu 0 by default)
+                overhead.enabled = 1;
+                if (optarg) overhead.cpu = atoi(optarg);
+                break;
+            case 'b':
+                //in case cmd is 'b', atof converts the argument to the cpu time budget of low-overhead mode, in percent of one cpu
+                overhead.budget = atof(optarg);
+                break;
+            case 'i':
+                //in case cmd is 'i', the collector named before the colon is sampled every number of milliseconds after it
+                colon = strchr(optarg, ':');
+                if(colon != NULL) *colon = '\0';
+                if(colon == NULL || (c = registry_find(&registry, optarg)) == NULL || atoi(colon + 1) <= 0){
+                    fprintf(stderr, "--interval expects NAME:MS with NAME one of memory, vmstat, users, cpu, irqs\n");
+                    return 1;
+                }
+                c->interval_ms = atoi(colon + 1);
+                break;
+            case 'm':
+                machine = 1; //in case cmd is 'm', 'machine' is set to 1
+                break;
+            case 'r':
+                irqs = 1; //in case cmd is 'r', 'irqs' is set to 1
+                break;
+            case 'z':
+                //in case cmd is 'z', the charts start at the zoom level named by the argument
+                for(zoom = ARCHIVE_HOUR; zoom > ARCHIVE_RAW && strcmp(optarg, archive_zoom_name(zoom)) != 0; zoom--);
+                break;
         }
 
     }
@@ -119,136 +182,65 @@ int main(int argc, char *argv[]) {
 
     signal(SIGINT, sigint_handler);
     //signal(SIGTSTP, sigtstp_handler);
-    
-    for (i = 0; i < samples; i++) { // iterate through the number of samples
 
-        set_cpu_values(&prev_cpu_struct); //sets the values of prev_cpu_usage to the current cpu usage values
-        sleep(tdelay);
+    display = (display_struct){0, samples, tdelay, sequential, graphics, chart_style, zoom, !user || (user && system), (user && system) || !system, machine, 0};
+    memory_collector.enabled = vmstat_collector.enabled = cpu_collector.enabled = display.show_system; //skipped if the argument contains just '--user'
+    users_collector.enabled = display.show_users; //skipped if system option was given without user
+    irq_collector.enabled = irqs && display.show_system; //only reported when asked for, as part of the system usage
+
+    reader_init(&reader);
+    registry_init(&registry, &reader, &display); //opens every file the collectors read once, missing ones are skipped
+    reader_start(&reader); //sets up io_uring, or falls back to pread when it is unavailable
+
+    now = monotonic_ms();
+    registry_start(&registry, &reader, now); //the first sample only provides what the first frame is measured against
+    next_frame = now + tdelay * 1000L;
+
+    if(overhead.enabled)
+        overhead_enter(&overhead); //pins, deprioritizes and locks the monitor now that every buffer is allocated
+
+    for (i = 0; i < samples; ) { // iterate through the number of frames
 
-        if (pipe(memory_pipe) == -1 || pipe(users_pipe) == -1 || pipe(cpu_pipe) == -1) { //if pipe fails, an error message is printed and the program exits
-            fprintf(stderr, "Pipe Failed" );
-            return 1;
+        now = monotonic_ms();
+        registry_sample(&registry, &reader, &display, now, !overhead.enabled); //samples every collector that is due
+
+        if(now < next_frame){
+            wake = registry_next(&registry); //sleeps until the next collector is due or the next frame, whichever is first
+            if(wake > next_frame) wake = next_frame;
+
+            wake_ts.tv_sec = wake / 1000;
+            wake_ts.tv_nsec = wake % 1000 * 1000000;
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake_ts, NULL); //a signal only wakes the loop early, it sleeps again
+            continue;
         }
 
-        //creates a child process for the memory information
-        
-        if(!user || (user && system))
-            pid_memory = fork(); //forks a child process for memory information
-
-        if (pid_memory < 0) {
-            fprintf(stderr, "Fork Failed");
-            return 2;
-        } else if (pid_memory == 0) {
-            // This is the memory information child process
-            signal(SIGINT, SIG_DFL); // Reset signal handler for SIGINT in child process
-            
-            close(memory_pipe[0]); //close the read end of the pipe
-            char str[MAX_LEN]={0};
-            write_memory_pipe(memory_pipe[1], &prev_virt, str, i, graphics); //write to the write end of the pipe
-            close(memory_pipe[1]); //close the write end of the pipe
-            exit(0); //exit the child process
+        if(overhead.enabled && (lowered = overhead_check(&overhead, &tdelay))) //measures the cpu time since the last frame and lowers the sampling rate if it is over budget
+            registry_lower_rate(&registry);
+
+        display.i = i;
+        display.tdelay = tdelay;
+        display.zoom = zoom; //SIGUSR1 may have switched it since the last frame
+        display.lowered = overhead.lowered;
 
+        if(machine){
+            registry_encode(&registry, &display); //one line per collector instead of the display
         } else {
-            if((user && system)||!system)
-                pid_users = fork();
-
-            if (pid_users < 0) {
-                fprintf(stderr, "Fork Failed");
-                return 2;
-            } else if (pid_users == 0) {
-                signal(SIGINT, SIG_DFL); // Reset signal handler for SIGINT in child process
-                //signal(SIGTSTP, SIG_DFL); // Reset signal handler for SIGTSTP in child process
-                close(users_pipe[0]); //close the read end of the pipe
-                write_users_pipe(users_pipe[1]); //write to the write end of the pipe
-                close(users_pipe[1]); //close the write end of the pipe
-                exit(0); //exit the child process
-            } else {
-                if(!user || (user && system))
-                    pid_cpu = fork();
-
-                if (pid_cpu < 0) {
-                    fprintf(stderr, "Fork Failed");
-                    return 2;
-                } else if (pid_cpu == 0) {
-                    // This is the cpu information child process
-                    signal(SIGINT, SIG_DFL); // Reset signal handler for SIGINT in child process
-                    //signal(SIGTSTP, SIG_DFL); // Reset signal handler for SIGTSTP in child process
-                    close(cpu_pipe[0]); //close the read end of the pipe
-                    write_cpu_pipe(cpu_pipe[1], &prev_cpu_struct); //write to the write end of the pipe
-                    close(cpu_pipe[1]); //close the write end of the pipe
-                    exit(0); //exit the child process
-                } else {
-                    // This is the main (parent) process
-
-                    close(memory_pipe[1]); //close the write end of the pipe
-                    close(users_pipe[1]); //close the write end of the pipe
-                    close(cpu_pipe[1]); //close the write end of the pipe
-                    
-                    waitpid(pid_memory, NULL, 0);
-                    waitpid(pid_cpu, NULL, 0);
-
-                    if(!user || (user && system)){
-                        mem_struct mem; //struct to store memory information
-                        read(memory_pipe[0], &mem, sizeof(mem));  //read from the read end of the pipe
-                        virt_used = mem.virt_used; //update the value of virt_used
-                        strcpy(strArr[i], mem.mem_str); //copy the memory information to strArr at index i
-
-                        read(cpu_pipe[0], &cur_cpu_usage, sizeof(cur_cpu_usage)); //reads the current cpu usage from the pipe
-                    }
-
-                    close(memory_pipe[0]); //close the read end of the pipe
-
-                    waitpid(pid_users, NULL, 0);
-                    if((user && system)||!system){
-                        user_queue = read_users_pipe(users_pipe[0]); //read from the read end of the pipe
-                    }
-
-                    close(users_pipe[0]); //close the read end of the pipe
-                    close(cpu_pipe[0]); //close the read end of the pipe
-                    
-
-                    display_header(i, sequential, samples, tdelay); //displays header information
-                    if(!user || (user && system)){ //runs so long as the argument doesn't contain just '--user'
-                        printf("---------------------------------------\n");
-
-                        if(graphics){
-                            modify_memory_graphics(i, virt_used, &prev_virt, strArr); //modify strArr graphically if graphics is an option
-                        }
-
-                        display_memory_line(sequential, samples, i, strArr); //displays lines of memory information according to sequential and strArr
-                        
-                        if((user && system)||!system){ //prints users if user and system are both options and skips if system option was given without user
-                            printf("---------------------------------------\n");
-                            printf("### Sessions/users ###\n"); //prints a header
-                            print_users(user_queue); //prints current user information on server
-                            printf("---------------------------------------\n");
-                        }
-
-                        print_cores(); //print the number of cores
-                        
-                        
-                        printf(" total cpu use: %.2f%%\n", cur_cpu_usage); //prints current cpu usage upto 2 decimal places
-
-
-                        if(graphics)
-                            cpu_graphics(cpuArr, i, sequential, &num_bar, cur_cpu_usage, &prev_cpu_usage); //if graphics option is given, display cpu graphics
-                    
-                    }else{ //runs when only user option is given
-                        printf("---------------------------------------\n");
-                        print_users(user_queue);
-                        printf("---------------------------------------\n");
-                    }
-
-                    user_queue = delete_users(user_queue); //deletes the user queue
-                }
-            }
+            display_header(i, sequential, samples, tdelay); //displays header information
+            print_reader(&reader); //displays how the last batch was read
+            if(overhead.enabled)
+                print_overhead(&overhead, tdelay, lowered); //displays the monitor's cpu time against its budget
+            registry_render(&registry, &display); //displays the section of every collector
         }
 
+        i++;
+        next_frame += tdelay * 1000L;
+        if(next_frame < now) next_frame = now + tdelay * 1000L; //frames missed while the monitor was stopped are skipped
     }
 
-    close(memory_pipe[0]); //close the read end of the pipe
-    close(users_pipe[0]); //close the read end of the pipe
-    close(cpu_pipe[0]); //close the read end of the pipe
+    registry_teardown(&registry);
+    reader_close(&reader); //tears down the ring and closes every file the samples read
+
+    if(machine) return 0; //machine-readable output ends with the last frame
 
     printf("---------------------------------------\n");
     print_machine_info(); //prints machine information all the time at the end
@@ -257,4 +249,4 @@ int main(int argc, char *argv[]) {
     return 0;
 
     
-}
\ No newline at end of file
+}
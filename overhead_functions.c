@@ -0,0 +1,83 @@
+#include "a3.h"
+
+// Low-overhead mode keeps the monitor out of the way of the workload it watches: the whole program (collectors and
+// display) is pinned to one housekeeping cpu and only runs when that cpu would otherwise be idle, its memory is
+// faulted in and locked up front so sampling never page faults, and the queries run in this process instead of
+// being forked each sample. The cpu time it uses is measured every sample against a budget, and the sampling rate
+// is lowered whenever the budget is exceeded.
+
+// returns the cpu seconds used so far by this process and every child process it has waited for
+static double cpu_seconds(void){
+    struct rusage self, children; //structs of type rusage found in <sys/resource.h>
+
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+
+    return self.ru_utime.tv_sec + self.ru_stime.tv_sec + children.ru_utime.tv_sec + children.ru_stime.tv_sec
+        + (self.ru_utime.tv_usec + self.ru_stime.tv_usec + children.ru_utime.tv_usec + children.ru_stime.tv_usec) / 1e6;
+}
+
+// returns the seconds elapsed on the monotonic clock
+static double wall_seconds(void){
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// touches OVERHEAD_STACK_PREFAULT bytes of stack so the pages are present before mlockall locks them
+static void prefault_stack(void){
+    volatile char stack[OVERHEAD_STACK_PREFAULT];
+
+    for(size_t off=0; off<sizeof(stack); off+=4096) stack[off] = 0;
+}
+
+void overhead_enter(overhead_struct *overhead){
+    cpu_set_t set; //a set of cpus found in <sched.h>
+    struct sched_param param = {0};
+
+    CPU_ZERO(&set);
+    CPU_SET(overhead->cpu, &set);
+    if(sched_setaffinity(0, sizeof(set), &set) == -1) //pins this process to the housekeeping cpu
+        fprintf(stderr, "sched_setaffinity: cannot pin to cpu %d: %s\n", overhead->cpu, strerror(errno));
+
+    if(sched_setscheduler(0, SCHED_IDLE, &param) == -1) //only runs when nothing else wants the cpu
+        fprintf(stderr, "sched_setscheduler: cannot use SCHED_IDLE: %s\n", strerror(errno));
+
+    if(setpriority(PRIO_PROCESS, 0, 19) == -1) //lowest nice value, in case SCHED_IDLE was refused
+        fprintf(stderr, "setpriority: %s\n", strerror(errno));
+
+    //every buffer is allocated by now, so faulting the stack in and locking what is mapped covers all of them;
+    //MCL_FUTURE is left out so that a small RLIMIT_MEMLOCK cannot make later allocations fail
+    prefault_stack();
+    if(mlockall(MCL_CURRENT) == -1)
+        fprintf(stderr, "mlockall: %s\n", strerror(errno));
+
+    overhead->cpu_time = cpu_seconds();
+    overhead->wall_time = wall_seconds();
+}
+
+int overhead_check(overhead_struct *overhead, int *tdelay){
+    double cpu_time = cpu_seconds(), wall_time = wall_seconds();
+
+    overhead->used = (wall_time > overhead->wall_time) ? (cpu_time - overhead->cpu_time) / (wall_time - overhead->wall_time) * 100 : 0.0;
+    overhead->cpu_time = cpu_time;
+    overhead->wall_time = wall_time;
+
+    if(overhead->used <= overhead->budget) return 0;
+
+    *tdelay = (*tdelay > 0) ? *tdelay * 2 : 1; //halves the sampling rate, the cost of a sample stays the same
+    overhead->lowered++;
+    return 1;
+}
+
+void print_overhead(overhead_struct *overhead, int tdelay, int lowered){
+    printf(" Overhead: %.2f%% cpu (budget %.2f%%) on cpu %d", overhead->used, overhead->budget, overhead->cpu);
+
+    if(lowered)
+        printf(" -- over budget, sampling rate lowered to every %d secs\n", tdelay);
+    else if(overhead->lowered > 0)
+        printf(" -- sampling rate lowered %d time%s\n", overhead->lowered, overhead->lowered == 1 ? "" : "s");
+    else
+        printf("\n");
+}
@@ -0,0 +1,329 @@
+#include "a3.h"
+
+// The reader is the layer every collector reads /proc and sysfs through. Each file is opened once and given a slot
+// in a single buffer; a sample then re-reads the slots of the collectors that are due from offset 0. With io_uring
+// those reads are submitted as one batch into the registered buffer and collected with a single io_uring_enter. Without io_uring
+// (old kernels, seccomp filters) every slot costs one pread instead. The reads happen in the main process before
+// forking, so every child process inherits buffers that are already filled.
+
+// thin wrappers around the io_uring syscalls, glibc does not provide any
+static int uring_setup(unsigned entries, struct io_uring_params *params){
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags){
+    return syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int uring_register(int ring_fd, unsigned opcode, void *arg, unsigned nr_args){
+    return syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+void reader_init(reader_struct *reader){
+    struct rlimit limit; //a struct of type rlimit found in <sys/resource.h>
+    rlim_t wanted = READER_MAX_SLOTS + READER_FD_RESERVE;
+
+    memset(reader, 0, sizeof(*reader));
+    reader->ring_fd = -1;
+    reader->group = READER_ALL_GROUPS;
+    reader->fd_budget = 1024 - READER_FD_RESERVE;
+
+    //the default soft limit of 1024 descriptors runs out on hosts with hundreds of cpus, so it is raised as far as
+    //the slots could need and the hard limit allows
+    if(getrlimit(RLIMIT_NOFILE, &limit) == 0){
+        if(limit.rlim_cur < wanted){
+            limit.rlim_cur = (limit.rlim_max < wanted) ? limit.rlim_max : wanted;
+            setrlimit(RLIMIT_NOFILE, &limit);
+            getrlimit(RLIMIT_NOFILE, &limit);
+        }
+        reader->fd_budget = (limit.rlim_cur > wanted ? wanted : limit.rlim_cur) - READER_FD_RESERVE;
+    }
+}
+
+int reader_add(reader_struct *reader, const char *path, size_t cap){
+    int fd;
+
+    if(reader->n_slots >= READER_MAX_SLOTS || reader->arena != NULL) return -1; //slots are fixed once the reader started
+
+    if((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0) return -1; //the file does not exist on this machine
+
+    reader->slots[reader->n_slots].path = NULL;
+    reader->slots[reader->n_slots].fixed = -1;
+
+    if(reader->n_open >= reader->fd_budget){ //no descriptor left to keep, the file is reopened at every read
+        close(fd);
+        fd = -1;
+        if((reader->slots[reader->n_slots].path = strdup(path)) == NULL){
+            perror("strdup");
+            exit(1);
+        }
+    } else {
+        reader->n_open++;
+    }
+
+    reader->slots[reader->n_slots].fd = fd;
+    reader->slots[reader->n_slots].group = reader->group;
+    reader->slots[reader->n_slots].cap = cap;
+    reader->slots[reader->n_slots].len = -1;
+
+    return reader->n_slots++;
+}
+
+// returns 1 if the kernel of the ring can run the opcode, asking with IORING_REGISTER_PROBE; kernels before 5.6 have
+// no probe and only the first opcodes, which include IORING_OP_READ_FIXED but not IORING_OP_READ
+static int uring_supports(int ring_fd, int opcode){
+    size_t len = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = (struct io_uring_probe *)calloc(1, len);
+    int supported;
+
+    if(probe == NULL){
+        perror("calloc");
+        exit(1);
+    }
+
+    if(uring_register(ring_fd, IORING_REGISTER_PROBE, probe, 256) < 0)
+        supported = (opcode == IORING_OP_READ_FIXED);
+    else
+        supported = (opcode <= probe->last_op && opcode < probe->ops_len && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED));
+
+    free(probe);
+    return supported;
+}
+
+// sets up the ring, registers the slot files and the arena with it, and returns 0 on success
+static int reader_start_uring(reader_struct *reader){
+    struct io_uring_params params;
+    struct iovec arena = {reader->arena, reader->arena_len};
+    unsigned entries = 1;
+    int fds[READER_MAX_SLOTS], n_fds = 0;
+    char *sq, *cq;
+
+    while(entries < (unsigned)reader->n_open && entries < READER_RING_ENTRIES) entries <<= 1; //a batch larger than the ring is submitted in pieces
+
+    memset(&params, 0, sizeof(params));
+    if((reader->ring_fd = uring_setup(entries, &params)) < 0) return -1;
+
+    reader->sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    reader->cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if(params.features & IORING_FEAT_SINGLE_MMAP){ //both rings live in one mapping
+        if(reader->cq_len > reader->sq_len) reader->sq_len = reader->cq_len;
+        reader->cq_len = 0;
+    }
+    reader->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    sq = mmap(NULL, reader->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, reader->ring_fd, IORING_OFF_SQ_RING);
+    if(sq == MAP_FAILED) return -1;
+    reader->sq_ring = sq;
+
+    if(reader->cq_len == 0){
+        cq = sq;
+    } else {
+        cq = mmap(NULL, reader->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, reader->ring_fd, IORING_OFF_CQ_RING);
+        if(cq == MAP_FAILED) return -1;
+        reader->cq_ring = cq;
+    }
+
+    reader->sqes = mmap(NULL, reader->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, reader->ring_fd, IORING_OFF_SQES);
+    if(reader->sqes == MAP_FAILED){
+        reader->sqes = NULL;
+        return -1;
+    }
+
+    reader->sq_head = (unsigned *)(sq + params.sq_off.head);
+    reader->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    reader->sq_mask = *(unsigned *)(sq + params.sq_off.ring_mask);
+    reader->sq_array = (unsigned *)(sq + params.sq_off.array);
+    reader->sq_entries = params.sq_entries;
+    reader->cq_head = (unsigned *)(cq + params.cq_off.head);
+    reader->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    reader->cq_mask = *(unsigned *)(cq + params.cq_off.ring_mask);
+    reader->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    for(int s=0; s<reader->n_slots; s++){ //only the descriptors kept open are registered
+        if(reader->slots[s].fd >= 0){
+            reader->slots[s].fixed = n_fds;
+            fds[n_fds++] = reader->slots[s].fd;
+        }
+    }
+    if(n_fds > 0 && uring_register(reader->ring_fd, IORING_REGISTER_FILES, fds, n_fds) < 0) return -1;
+
+    //registered buffers are pinned once instead of on every read, but count against RLIMIT_MEMLOCK on older kernels,
+    //so plain reads into the same arena are used when registering fails
+    reader->fixed_buffers = uring_register(reader->ring_fd, IORING_REGISTER_BUFFERS, &arena, 1) == 0;
+
+    //the plain read opcode only exists from 5.6, so an older kernel that would not register the arena gets pread
+    if(!uring_supports(reader->ring_fd, reader->fixed_buffers ? IORING_OP_READ_FIXED : IORING_OP_READ)) return -1;
+
+    return 0;
+}
+
+// unmaps the rings and closes the ring descriptor, leaving the reader on pread
+static void reader_stop_uring(reader_struct *reader){
+    if(reader->sqes) munmap(reader->sqes, reader->sqes_len);
+    if(reader->cq_ring) munmap(reader->cq_ring, reader->cq_len);
+    if(reader->sq_ring) munmap(reader->sq_ring, reader->sq_len);
+    if(reader->ring_fd >= 0) close(reader->ring_fd);
+
+    reader->sqes = NULL;
+    reader->cq_ring = reader->sq_ring = NULL;
+    reader->ring_fd = -1;
+}
+
+int reader_start(reader_struct *reader){
+    size_t offset = 0;
+
+    for(int s=0; s<reader->n_slots; s++) reader->arena_len += reader->slots[s].cap + 1; //+1 to NUL terminate every slot
+    if(reader->arena_len == 0) reader->arena_len = 1;
+
+    reader->arena = mmap(NULL, reader->arena_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(reader->arena == MAP_FAILED){
+        perror("mmap");
+        exit(1);
+    }
+
+    for(int s=0; s<reader->n_slots; s++){
+        reader->slots[s].buf = reader->arena + offset;
+        offset += reader->slots[s].cap + 1;
+    }
+
+    if(reader->n_open > 0 && reader_start_uring(reader) < 0) reader_stop_uring(reader); //io_uring is unavailable, fall back to pread
+
+    return reader->ring_fd >= 0;
+}
+
+// submits one read per pending slot kept open to the ring and reaps every completion, returning the number of syscalls made or -1
+static int reader_submit_uring(reader_struct *reader){
+    int syscalls = 0;
+
+    for(int done=0; done<reader->n_kept;){
+        int batch = reader->n_kept - done, reaped = 0;
+        unsigned tail = *reader->sq_tail; //only this process produces submissions
+
+        if(batch > (int)reader->sq_entries) batch = reader->sq_entries;
+
+        for(int p=done; p<done + batch; p++, tail++){
+            int s = reader->pending[p];
+            unsigned index = tail & reader->sq_mask;
+            struct io_uring_sqe *sqe = &reader->sqes[index];
+
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = reader->fixed_buffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+            sqe->flags = IOSQE_FIXED_FILE;
+            sqe->fd = reader->slots[s].fixed; //index into the registered files
+            sqe->addr = (unsigned long)reader->slots[s].buf;
+            sqe->len = reader->slots[s].cap;
+            sqe->off = 0; //every read starts from the beginning of the file
+            sqe->buf_index = 0; //the whole arena is registered as buffer 0
+            sqe->user_data = s;
+            reader->sq_array[index] = index;
+        }
+        __atomic_store_n(reader->sq_tail, tail, __ATOMIC_RELEASE);
+
+        while(reaped < batch){
+            unsigned to_submit = tail - __atomic_load_n(reader->sq_head, __ATOMIC_ACQUIRE);
+            unsigned head = *reader->cq_head;
+
+            if(uring_enter(reader->ring_fd, to_submit, batch - reaped, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) return -1;
+            syscalls++;
+
+            for(; head != __atomic_load_n(reader->cq_tail, __ATOMIC_ACQUIRE); head++, reaped++){
+                struct io_uring_cqe *cqe = &reader->cqes[head & reader->cq_mask];
+                reader->slots[cqe->user_data].len = cqe->res; //bytes read, or -errno
+            }
+            __atomic_store_n(reader->cq_head, head, __ATOMIC_RELEASE);
+        }
+
+        done += batch;
+    }
+
+    return syscalls;
+}
+
+int reader_submit(reader_struct *reader, unsigned groups){
+    int syscalls = -1;
+
+    reader->n_read = 0;
+    for(int s=0; s<reader->n_slots; s++){ //only the files of the collectors that are due are read, kept descriptors first
+        if((reader->slots[s].group & groups) && reader->slots[s].fd >= 0) reader->pending[reader->n_read++] = s;
+    }
+    reader->n_kept = reader->n_read;
+    for(int s=0; s<reader->n_slots; s++){
+        if((reader->slots[s].group & groups) && reader->slots[s].fd < 0) reader->pending[reader->n_read++] = s;
+    }
+
+    if(reader->ring_fd >= 0 && (syscalls = reader_submit_uring(reader)) < 0){
+        fprintf(stderr, "io_uring_enter failed, falling back to pread\n");
+        reader_stop_uring(reader);
+    } else if(reader->ring_fd >= 0){
+        int recovered = 0;
+
+        for(int p=0; p<reader->n_kept; p++){ //a read the ring rejected is done again with pread, so no sample is lost to it
+            int s = reader->pending[p];
+
+            if(reader->slots[s].len >= 0) continue;
+            reader->slots[s].len = pread(reader->slots[s].fd, reader->slots[s].buf, reader->slots[s].cap, 0);
+            recovered += (reader->slots[s].len >= 0);
+            syscalls++;
+        }
+
+        if(reader->n_kept > 0 && recovered == reader->n_kept){ //the ring failed every read pread could do, so it is not used again
+            fprintf(stderr, "io_uring rejected every read, falling back to pread\n");
+            reader_stop_uring(reader);
+        }
+    }
+
+    if(reader->ring_fd < 0){
+        syscalls = 0;
+        for(int p=0; p<reader->n_kept; p++, syscalls++){
+            int s = reader->pending[p];
+            reader->slots[s].len = pread(reader->slots[s].fd, reader->slots[s].buf, reader->slots[s].cap, 0);
+        }
+    }
+
+    for(int p=reader->n_kept; p<reader->n_read; p++){ //files past the descriptor budget cost an open, a read and a close
+        int s = reader->pending[p], fd = open(reader->slots[s].path, O_RDONLY | O_CLOEXEC);
+
+        reader->slots[s].len = (fd >= 0) ? pread(fd, reader->slots[s].buf, reader->slots[s].cap, 0) : -1;
+        if(fd >= 0) close(fd);
+        syscalls += 3;
+    }
+
+    for(int p=0; p<reader->n_read; p++){ //NUL terminates every slot read so text files can be parsed in place
+        int s = reader->pending[p];
+        reader->slots[s].buf[reader->slots[s].len > 0 ? reader->slots[s].len : 0] = '\0';
+    }
+
+    reader->syscalls = syscalls;
+    return syscalls;
+}
+
+char *reader_data(reader_struct *reader, int slot){
+    if(slot < 0 || slot >= reader->n_slots || reader->slots[slot].len < 0) return NULL;
+    return reader->slots[slot].buf;
+}
+
+ssize_t reader_len(reader_struct *reader, int slot){
+    if(slot < 0 || slot >= reader->n_slots) return -1;
+    return reader->slots[slot].len;
+}
+
+//  prints how the last batch was read and the syscalls saved compared to an open/read/close of every file
+void print_reader(reader_struct *reader){
+    int baseline = reader->n_kept + 3 * (reader->n_read - reader->n_kept); //what the pread fallback costs for the same batch
+
+    printf(" Reads: %d of %d files in %d syscall%s via %s (%d saved per batch)\n", reader->n_read, reader->n_slots, reader->syscalls,
+        reader->syscalls == 1 ? "" : "s", reader->ring_fd >= 0 ? "io_uring" : "pread", baseline - reader->syscalls);
+}
+
+void reader_close(reader_struct *reader){
+    reader_stop_uring(reader);
+
+    for(int s=0; s<reader->n_slots; s++){
+        if(reader->slots[s].fd >= 0) close(reader->slots[s].fd);
+        free(reader->slots[s].path);
+    }
+    if(reader->arena != NULL && reader->arena != MAP_FAILED) munmap(reader->arena, reader->arena_len);
+
+    reader->arena = NULL;
+    reader->n_slots = reader->n_open = 0;
+}
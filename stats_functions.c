@@ -46,153 +46,193 @@ void enqueue(users *q, char line[UT_LINESIZE + UT_NAMESIZE + UT_HOSTSIZE + 10]){
     q->tail = node;
 }
 
-void write_memory_pipe(int write_fd, double *prev_virt, char str[MAX_LEN], int i, int graphics){
-
-    mem_struct memory; // declare a struct of type mem_struct
-    double virt_used = write_memory(str, i); // write memory information to strArr at index i and return virtual memory used
-
-    strcpy(memory.mem_str, str); // store str in memory struct
-    memory.virt_used = virt_used; // store virtual memory used in memory struct
-    
-    write(write_fd, &memory, sizeof(memory)); // write str to pipe
+// returns the value in kB of the /proc/meminfo field 'key' (e.g. "MemTotal:"), or 0 if it is missing
+static unsigned long meminfo_value(const char *meminfo, const char *key){
+    const char *field = strstr(meminfo, key);
+    return field ? strtoul(field + strlen(key), NULL, 10) : 0;
 }
 
+// stores calculated physical and virtual memory information, and a string of it for display, in mem and returns virtual used memory
+double write_memory(mem_struct *mem, const char *meminfo){
+    double phys_used, phys_total, virt_used, virt_total;
+    unsigned long totalram, freeram, totalswap, freeswap;
 
-// stores calculated physical and virtual memory information as a string in strArr at index i and returns virtual used memory
-double write_memory(char str[MAX_LEN], int i){
-    struct sysinfo sys_info;    //a struct of type sysinfo is declared to store system information (from <sys/sysinfo.h>)
-    double phys_used, phys_total, virt_used, virt_total; 
-    
-    sysinfo(&sys_info); //retrieves information about the system into sys_info
+    if(meminfo == NULL){ //checks if the reader managed to read /proc/meminfo
+        fprintf(stderr, "Error reading /proc/meminfo\n");
+        exit(1);
+    }
+
+    //the same fields sysinfo reports, in kB, parsed from the buffer the reader filled for this sample
+    totalram = meminfo_value(meminfo, "MemTotal:");
+    freeram = meminfo_value(meminfo, "MemFree:");
+    totalswap = meminfo_value(meminfo, "SwapTotal:");
+    freeswap = meminfo_value(meminfo, "SwapFree:");
 
     //physical memory used calculated by subtracting free physical memory from the total physical memory and converting to gigabytes
-    phys_used = (float)(sys_info.totalram - sys_info.freeram)/1024/1024/1024; 
-    phys_total = (float)sys_info.totalram/1024/1024/1024; //storing total physical memory and dividing to convert the value to gigabytes
+    phys_used = (float)(totalram - freeram)/1024/1024; 
+    phys_total = (float)totalram/1024/1024; //storing total physical memory and dividing to convert the value to gigabytes
     
     //virtual memory used calculated by adding the used physical memory to the used virtual memory obtained by subtracting the free virtual memory
-    //from the total virtual memory and dividing by 1024^3 to convert it to gigabytes.
-    virt_used = phys_used + (float)(sys_info.totalswap - sys_info.freeswap) /1024/1024/1024;
+    //from the total virtual memory and dividing by 1024^2 to convert it from kB to gigabytes.
+    virt_used = phys_used + (float)(totalswap - freeswap) /1024/1024;
     
-    virt_total = (float)(sys_info.totalram + sys_info.totalswap)/1024/1024/1024; //total virtual memory calculated by adding total physical memory to total virtual memory
+    virt_total = (float)(totalram + totalswap)/1024/1024; //total virtual memory calculated by adding total physical memory to total virtual memory
 
-    sprintf(str, "%.2f GB / %.2f GB -- %.2f GB / %.2f GB",  
-    phys_used, phys_total, virt_used, virt_total); //store the calculated physical and virtual memory information as a string into strArr at index i
+    sprintf(mem->mem_str, "%.2f GB / %.2f GB -- %.2f GB / %.2f GB",
+    phys_used, phys_total, virt_used, virt_total); //store the calculated physical and virtual memory information as a string for display
+
+    mem->phys_used = phys_used; //the values are kept as numbers too, for machine-readable output
+    mem->phys_total = phys_total;
+    mem->virt_used = virt_used;
+    mem->virt_total = virt_total;
 
     return virt_used; //returns the virtual used memory
 }
 
+// the /proc/vmstat counters kept, and the entry of the vmstat table each one is added to
+static const struct {
+    const char *key;
+    int index;
+} vmstat_keys[] = {
+    {"pgfault", VMSTAT_PGFAULT},
+    {"pgmajfault", VMSTAT_PGMAJFAULT},
+    {"pswpin", VMSTAT_PSWPIN},
+    {"pswpout", VMSTAT_PSWPOUT},
+    {"pgscan_kswapd", VMSTAT_PGSCAN},
+    {"pgscan_direct", VMSTAT_PGSCAN},
+    {"pgscan_khugepaged", VMSTAT_PGSCAN},
+    {"pgscan_proactive", VMSTAT_PGSCAN},
+    {"pgsteal_kswapd", VMSTAT_PGSTEAL},
+    {"pgsteal_direct", VMSTAT_PGSTEAL},
+    {"pgsteal_khugepaged", VMSTAT_PGSTEAL},
+    {"pgsteal_proactive", VMSTAT_PGSTEAL},
+    {"oom_kill", VMSTAT_OOM_KILL},
+};
+
+// parses the "name value" lines of /proc/vmstat, only comparing the names of lines that can be one of vmstat_keys
+unsigned vmstat_parse(const char *vmstat, unsigned long long values[VMSTAT_COUNTERS]){
+    unsigned present = 0;
+
+    if(vmstat == NULL) return 0; //the read failed, values is left as it was
+
+    memset(values, 0, VMSTAT_COUNTERS * sizeof(values[0]));
+
+    for(const char *line = vmstat, *next; *line != '\0'; line = next){
+        const char *space = strchr(line, ' ');
+
+        if((next = strchr(line, '\n')) != NULL) next++;
+        else next = line + strlen(line); //the last line may not end in a newline, the loop then stops at its NUL
+        if(line[0] != 'p' && line[0] != 'o') continue; //every kept name starts with "pg", "psw" or "oom"
+        if(space == NULL || space > next) continue;
+
+        for(size_t k=0; k<sizeof(vmstat_keys) / sizeof(vmstat_keys[0]); k++){
+            if(strncmp(line, vmstat_keys[k].key, space - line) == 0 && vmstat_keys[k].key[space - line] == '\0'){
+                values[vmstat_keys[k].index] += strtoull(space + 1, NULL, 10);
+                present |= 1u << vmstat_keys[k].index;
+                break;
+            }
+        }
+    }
+
+    return present;
+}
+
+double vmstat_rate(vmstat_payload *vmstat, int counter){
+    if(!(vmstat->present & (1u << counter)) || vmstat->elapsed_ms <= 0) return 0.0;
+    return vmstat->delta[counter] * 1000.0 / vmstat->elapsed_ms;
+}
+
+//  prints the paging and swap rates of the last sample, and the OOM kills if there were any
+void print_vmstat(vmstat_payload *vmstat){
+    if(vmstat->present == 0){ //nothing was read for this interval, the rates resume with the next sample
+        printf(" paging: /proc/vmstat could not be read\n");
+        return;
+    }
+
+    printf(" paging: %.0f faults/s (%.0f major) -- swap in %.0f / out %.0f pages/s -- reclaim scanned %.0f / stolen %.0f pages/s\n",
+        vmstat_rate(vmstat, VMSTAT_PGFAULT), vmstat_rate(vmstat, VMSTAT_PGMAJFAULT), vmstat_rate(vmstat, VMSTAT_PSWPIN),
+        vmstat_rate(vmstat, VMSTAT_PSWPOUT), vmstat_rate(vmstat, VMSTAT_PGSCAN), vmstat_rate(vmstat, VMSTAT_PGSTEAL));
+
+    if(vmstat->delta[VMSTAT_OOM_KILL] > 0)
+        printf(" OOM killer: %llu process%s killed\n", vmstat->delta[VMSTAT_OOM_KILL], vmstat->delta[VMSTAT_OOM_KILL] == 1 ? "" : "es");
+}
+
 // modifies a string representation of the virtual memory usage of the system for future printing use
-void modify_memory_graphics(int i, double virt_used, double *prev_virt, char strArr[][1024]){
-    
-    char line[1024]="\0", temp[1024]="\0"; // initialize empty strings
-    int iter=0;
+void modify_memory_graphics(int i, double virt_used, double *prev_virt, char line[1024]){
+
+    static char bars[2][MEM_BAR_MAX + 1]; // runs of '#' (growth) and ':' (shrink), built once and printed with a precision
+    int iter=0, len=strlen(line);
     double diff=0.00;
 
-    strcpy(line, "   |");
-    
+    if(bars[0][0] == '\0'){
+        memset(bars[0], '#', MEM_BAR_MAX);
+        memset(bars[1], ':', MEM_BAR_MAX);
+    }
+
     if(i==0)
         diff=0.00; //on first iteration, set diff to 0 since no previous iteration exists
     else
         diff=virt_used - *(prev_virt); //calculates the difference between the current virtual memory usage and the previous usage
     
     if(diff>=0.00 && diff<0.01){
-        strcat(line, "o "); //if the differenece is nonnegative and less than 0.01 GB, then "o" is concatenated to 'line'
+        snprintf(line + len, 1024 - len, "   |o %.2f (%.2f)", diff, virt_used); //if the differenece is nonnegative and less than 0.01 GB, then "o" is drawn
     } else if (diff<0 && diff>-0.01){
-        strcat(line, "@ "); //if the difference is negative and greater than -0.01 GB, then "@" is concatenated to 'line'
+        snprintf(line + len, 1024 - len, "   |@ %.2f (%.2f)", diff, virt_used); //if the difference is negative and greater than -0.01 GB, then "@" is drawn
     } else {
         iter = fabs((int) ((diff-(int)diff+0.005)*100)); //otherwise, stores the first two decimal places of the difference into a variable as an integer
-        
-        if(diff<0){
-            for(int i=0; i<iter; i++) {strcat(line, ":");} //if difference is negative, the loop concatenates ':' to 'line' ('iter' number of times)
-            strcat(line, "@ "); //then concatenates "@ " to the string
-        } else {
-            for(int i=0; i<iter; i++) {strcat(line, "#");} //if difference is nonnegative, the loop concatenates '#' to 'line' ('iter' number of times)
-            strcat(line, "* "); //then concatenates "* " to the string
-        }  
+        if(iter > MEM_BAR_MAX) iter = MEM_BAR_MAX;
 
+        //a negative difference draws 'iter' ':' followed by "@", a nonnegative one draws 'iter' '#' followed by "*"
+        snprintf(line + len, 1024 - len, "   |%.*s%s %.2f (%.2f)", iter, bars[diff<0], diff<0 ? "@" : "*", diff, virt_used);
     }
 
     *(prev_virt)=virt_used; //the value of virt_used memory is stored in prev_virt for future calculation/use of prev_virt in the upcoming iterations of sampling
-    sprintf(temp, "%.2f (%.2f)", diff, virt_used); //stores the difference of virtual memory (prev and cur) and virtual used memory into the 'temp' string 
-    strcat(line, temp); //concatenates temp to line
-    strcat(strArr[i], line); //'line' string that has been formatted is concatenated to strArr at the current iteration index passed from main
-    
 }
 
-//displays memory usage information stored in an array of strings 'strArr' according to sequential flag
-void display_memory_line(int sequential, int samples, int i, char strArr[][1024]){
-    int j=0;
+//displays memory usage information stored in the ring 'strArr' according to sequential flag, the history being capped at 'rows' lines
+void display_memory_line(int sequential, int samples, int rows, int i, char strArr[][1024]){
+    int j=0, first=(i + 1 > rows) ? i + 1 - rows : 0; //the oldest frame still shown without sequential
     printf("### Memory ### (Phys.Used/Tot -- Virtual Used/Tot)\n"); //prints header
 
     if(sequential){ //checks if sequential is true (i.e: 1)
-        for(j=0; j<samples; j++){ //goes through all the elements in strArr
+        for(j=0; j<samples; j++){ //goes through every sample, the blank rows need no stored line
             if(j==i) //if the current iternation index equals the current index samples loop from main 
-                printf("%s\n", strArr[j]); //then the corresponding current memory information stored in strArr at the index is printed
+                printf("%s\n", strArr[j % MEM_LINES_MAX]); //then the corresponding current memory information stored in strArr is printed
             else
                 printf("\n"); //otherwise fill the lines with a new line
         }
     } else {
-        for(j=0; j<=i; j++) printf("%s\n", strArr[j]); //if sequential is false, prints all the elements in strArr upto the current index 'i' passed from main
-        for(int k=j+1; k<=samples; k++) printf("\n"); //fills the rest of the lines with a new line until it reaches # of samples
+        for(j=first; j<=i; j++) printf("%s\n", strArr[j % MEM_LINES_MAX]); //if sequential is false, prints the lines of the last frames upto the current index 'i' passed from main
+        for(int k=j-first; k<rows; k++) printf("\n"); //fills the rest of the lines with a new line so every frame has the same height
     }
 }
 
 
 
-void write_users_pipe(int write_fd){
-
-     //printf("### Sessions/users ###\n"); //prints a header
-
-    setutent(); //resets the internal stream of the utmp database to the beginning for reading utmp.h file
-    
-    for(struct utmp *user=NULL; (user=getutent());){ //read the records of the utmp database one by one until it returns a NULL pointer signalling the end
-
-        if(user->ut_type != USER_PROCESS) continue; //checks if the user is currently logged into the system and running a process
-        
-        int len = snprintf(NULL, 0, " %s\t%s\t(%s)\n", user->ut_user, user->ut_line, user->ut_host);
-
-        if(len<0) {
-            perror("snprintf");
-            return;
-        } else {
-            len++;
-        }
-
-        char userStr[len];
-        memset(userStr, 0, sizeof(userStr));
-        snprintf(userStr, len, " %s\t%s\t(%s)\n", user->ut_user, user->ut_line, user->ut_host);
-        
-        write(write_fd, userStr, len);
-        
-    }
-
-    endutent(); //closes the internal stream of the utmp database
-    //write(write_fd, "END\0", 4); //write end of string to pipe
-    
+// copies the utmp record at byte 'off' out of the records the reader read (so it is suitably aligned)
+// and returns 1 if it belongs to a user currently logged into the system and running a process
+int user_record(const char *utmp, ssize_t off, struct utmp *record){
+    memcpy(record, utmp + off, sizeof(*record));
+    return record->ut_type == USER_PROCESS;
 }
 
-users* read_users_pipe(int read_fd){
+users *read_users(const char *utmp, ssize_t utmp_len){
 
     users *queue = setUp(); //initialize queue
+    char userStr[UT_NAMESIZE+UT_LINESIZE+UT_HOSTSIZE+10];
 
     if(queue==NULL){
         perror("calloc");
         exit(EXIT_FAILURE);
     }
 
-    //read from pipe
-    char userStr[UT_NAMESIZE+UT_LINESIZE+UT_HOSTSIZE+10];
-    int bytesRead=0;
-
-    while((bytesRead = read(read_fd, userStr, sizeof(userStr))) > 0){
-        
-        if (bytesRead < sizeof(userStr)) {
-            userStr[bytesRead] = '\0';
-        } else {
-            userStr[sizeof(userStr) - 1] = '\0';
-        }
+    //walks the utmp records, ignoring a partial record at the end
+    for(ssize_t off = 0; utmp != NULL && off + (ssize_t)sizeof(struct utmp) <= utmp_len; off += sizeof(struct utmp)){
+        struct utmp record;
 
+        if(!user_record(utmp, off, &record)) continue;
 
+        snprintf(userStr, sizeof(userStr), " %s\t%s\t(%s)\n", record.ut_user, record.ut_line, record.ut_host);
         enqueue(queue, userStr);
     }
 
@@ -227,41 +267,53 @@ void print_users(users *queue){
 
 /*###############################################################################################*/
 
-void write_cpu_pipe(int write_fd, cpu_struct *prevSample){
-    
-    cpu_struct curSample; //declaring two structs of type cpu_struct
-    float cur_cpu_usage=0.00; //declaring a float variable to store the calculated cpu usage
+ssize_t read_all(int read_fd, void *buf, size_t len){
+    size_t total = 0;
+    ssize_t bytesRead = 0;
+
+    while(total < len){ //a pipe may hand back a large write in pieces
+        bytesRead = read(read_fd, (char *)buf + total, len - total);
+        if(bytesRead < 0 && errno == EINTR) continue; //a signal arrived before any data, so the read is retried
+        if(bytesRead <= 0) break;
+        total += bytesRead;
+    }
+
+    return total;
+}
 
-    set_cpu_values(&curSample); //setting cpu values of 'curSample'
 
-    //calculating cpu usage
-    cur_cpu_usage = calculate_cpu_usage(prevSample, &curSample); //calculates and assigns 'cur_cpu_usage' based on 'prevSample' and 'curSample'
-    write(write_fd, &cur_cpu_usage, sizeof(cur_cpu_usage)); //writes the calculated cpu usage to the pipe
+ssize_t write_all(int write_fd, const void *buf, size_t len){
+    size_t total = 0;
+    ssize_t bytesWritten = 0;
 
+    while(total < len){ //a payload larger than the pipe buffer goes out in pieces as the reader drains it
+        bytesWritten = write(write_fd, (const char *)buf + total, len - total);
+        if(bytesWritten < 0 && errno == EINTR) continue; //a signal (such as ctrl + z) arrived before any data, so the write is retried
+        if(bytesWritten <= 0) break;
+        total += bytesWritten;
+    }
+
+    return total;
 }
 
 
-void set_cpu_values(cpu_struct *sample)
+void set_cpu_values(cpu_struct *sample, const char *stat)
 {
-    FILE *fp = fopen("/proc/stat", "r"); //opening /proc/stat file in read-mode and assigns the returned file pointer to fp
-
-    if(fp==NULL){ //checks if file opening is successful
-        fprintf(stderr, "File could not be opened\n"); //if there was an error opening file, the message is printed to stderr
+    if(stat==NULL){ //checks if the reader managed to read /proc/stat
+        fprintf(stderr, "File could not be opened\n"); //if there was an error reading the file, the message is printed to stderr
         exit(1); //exit program
     }
 
     char buffer[255]; //a char array used to store the format string
-    //fscanf is used to read data from the file into the variables
-    int success = fscanf(fp, "%s %lu %lu %lu %lu %lu %lu %lu", buffer, &(sample->user), &(sample->nice), 
+    //sscanf is used to read data from the buffer the reader filled into the variables
+    int success = sscanf(stat, "%254s %lu %lu %lu %lu %lu %lu %lu", buffer, &(sample->user), &(sample->nice), 
         &(sample->system), &(sample->idle), &(sample->iowait), &(sample->irq), &(sample->softirq));
     //specifies that the function should read one string followed by seven unsigned long integers
 
-    if(success!=8){ //checks the number of items successfully read by fscanf
+    if(success!=8){ //checks the number of items successfully read by sscanf
         fprintf(stderr, "Error reading file\n");    //prints error message to stderr if error occurs
-        fclose(fp); //close file pointer
         exit(1); //exit program
     }
-    fclose(fp); //close file pointer
 }
 
 
@@ -277,6 +329,8 @@ double calculate_cpu_usage(cpu_struct *prev, cpu_struct *cur)
     int prev_util = prev_total - prev->idle; //calculating the total cpu utilization in prev sample
     int cur_util = cur_total - cur->idle; //calculating the total cpu utilization in cur sample
 
+    if(cur_total == prev_total) return 0.0; //no tick has passed between samples taken less than a jiffy apart
+
     return (double)(cur_util - prev_util) / (cur_total - prev_total) * 100; //calculating and returning the cpu usage percentage
 
 }
@@ -319,37 +373,7 @@ void print_machine_info(void){
     printf(" Architecture = %s\n", sysData.machine); //prints machine architecture (computer hardware type)
 }
 
-//  updates and displays the current CPU usage graphics in a graphical format
-void cpu_graphics(char cpuArr[][200], int i, int sequential, int *num_bar, float cur_cpu_usage, float *prev_cpu_usage){
-    int diff_bar=0; //initialize a variable that records the difference in bars ("|") between iterations
-    char cpuStr[200]="\0"; //initialize an empty string
-
-    if(i==0){
-        sprintf(cpuArr[i], "         |||%.2f", cur_cpu_usage); //on first iteration, stores default of 3 bars followed by current cpu usage into first element of cpuArr
-    } else {
-        diff_bar = (int)cur_cpu_usage - (int)(*(prev_cpu_usage)); //otherwise, calculates the difference in CPU usage between prev and cur iterations (only looking at the integer part)
-        *(num_bar) += diff_bar; //updates the current 'num_bar' value with the new difference in number of bars calculated above
-        strcpy(cpuArr[i], "         "); //copies space into cpuArr at index i
-        
-        for(int m=0; m<*(num_bar); m++) {
-            strcat(cpuArr[i], "|"); //appends the number of bars represented by 'num_bar' and writes to cpuArr at index i
-        }
-        sprintf(cpuStr, "%.2f", cur_cpu_usage); //writes the current cpu usage upto 2 decimal places into cpuStr string
-        strcat(cpuArr[i], cpuStr); //concatenates cpuStr into the already graphically formatted string of cpuArr at index i
-    }
-
-    if(sequential){ //checks if sequential is true (i.e. 1)
-        for(int j=0; j<=i; j++){ //then iterate through the cpuArr upto the current iteration index i from main
-            if(j==i) //if index j matches the current iteration index i from main
-                printf("%s\n", cpuArr[j]); //prints the current iteration of cpuArr at index j
-            else
-                printf("\n"); //otherwise leave the rest blank (i.e. fill in the links with a new line)
-        }
-    } else { //if sequential is false
-        for(int h=0; h<=i; h++){ //iterate through cpuArr upto the current iteration index i from main
-            printf("%s\n", cpuArr[h]); //prints the entire cpuArr upto and including the current iteration
-        }
-    }
-
-    *(prev_cpu_usage) = cur_cpu_usage; //sets the 'prev_cpu_usage' to 'cur_cpu_usage' for later iteration(s)
+//  displays the CPU usage history at the zoom level as a chart scaled to the terminal width
+void cpu_graphics(archive_struct *archive, int style, int zoom){
+    display_archive(archive, zoom, style, "cpu usage (%)"); //O(width) no matter how many samples were taken
 }
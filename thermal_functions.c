@@ -0,0 +1,163 @@
+#include "a3.h"
+
+// The frequency, throttling and thermal collector adds every sysfs file it needs to the reader once, before sampling
+// starts. The reader re-reads them all as part of each sample's batch, so the cpu process only parses buffers.
+
+// parses the single integer a reader slot holds, returning -1 when the file is missing or its read failed
+static long slot_value(reader_struct *reader, int slot){
+    char *data = reader_data(reader, slot);
+    return (data == NULL || data[0] == '\0') ? -1 : strtol(data, NULL, 10);
+}
+
+// reads the physical package a cpu belongs to, -1 if the topology is not exposed
+static int package_of(int cpu){
+    char path[MAX_LEN], id[SYSFS_VALUE_LEN];
+    int fd, package = -1;
+    ssize_t len;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+    if((fd = open(path, O_RDONLY | O_CLOEXEC)) >= 0){ //the topology never changes, so it is read once and closed
+        if((len = read(fd, id, sizeof(id) - 1)) > 0){
+            id[len] = '\0';
+            package = atoi(id);
+        }
+        close(fd);
+    }
+    return package;
+}
+
+int thermal_open(thermal_struct *thermal, reader_struct *reader){
+    char path[MAX_LEN];
+    int opened = 0, packages[THERMAL_MAX_CORES];
+
+    thermal->n_cores = sysconf(_SC_NPROCESSORS_CONF); //every configured core, including those currently offline
+    if(thermal->n_cores > THERMAL_MAX_CORES) thermal->n_cores = THERMAL_MAX_CORES;
+    if(thermal->n_cores < 0) thermal->n_cores = 0;
+
+    for(int c=0; c<thermal->n_cores; c++){
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_cur_freq", c);
+        thermal->freq_slot[c] = reader_add(reader, path, SYSFS_VALUE_LEN);
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/thermal_throttle/core_throttle_count", c);
+        thermal->core_throttle_slot[c] = reader_add(reader, path, SYSFS_VALUE_LEN);
+        opened += (thermal->freq_slot[c] >= 0) + (thermal->core_throttle_slot[c] >= 0);
+    }
+
+    //every cpu of a package reports the same package counter, so it is only read through the first cpu of each package
+    thermal->n_packages = 0;
+    for(int c=0; c<thermal->n_cores; c++){
+        int package = package_of(c), p;
+
+        for(p=0; p<thermal->n_packages && packages[p] != package; p++);
+        if(p < thermal->n_packages) continue;
+
+        packages[thermal->n_packages] = package;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/thermal_throttle/package_throttle_count", c);
+        thermal->pkg_throttle_slot[thermal->n_packages] = reader_add(reader, path, SYSFS_VALUE_LEN);
+        opened += (thermal->pkg_throttle_slot[thermal->n_packages] >= 0);
+        thermal->n_packages++;
+    }
+
+    thermal->n_zones = 0;
+    for(int z=0; z<THERMAL_MAX_ZONES; z++){
+        int type_fd;
+        ssize_t len;
+
+        snprintf(path, sizeof(path), "/sys/class/thermal/thermal_zone%d/temp", z);
+        if((thermal->zone_slot[thermal->n_zones] = reader_add(reader, path, SYSFS_VALUE_LEN)) < 0) break; //zones are numbered contiguously
+
+        snprintf(path, sizeof(path), "/sys/class/thermal/thermal_zone%d/type", z);
+        strcpy(thermal->zone_type[thermal->n_zones], "zone"); //the type never changes, so it is read once here
+        if((type_fd = open(path, O_RDONLY | O_CLOEXEC)) >= 0){
+            char type[THERMAL_TYPE_LEN];
+
+            if((len = read(type_fd, type, sizeof(type) - 1)) > 0){
+                type[len] = '\0';
+                type[strcspn(type, "\n")] = '\0';
+                strcpy(thermal->zone_type[thermal->n_zones], type);
+            }
+            close(type_fd);
+        }
+
+        thermal->n_zones++;
+        opened++;
+    }
+
+    thermal->n_values = 2 * thermal->n_cores + thermal->n_packages + thermal->n_zones;
+    return opened;
+}
+
+void thermal_read(thermal_struct *thermal, reader_struct *reader, long *values){
+    int n = thermal->n_cores, zones = 2 * n + thermal->n_packages;
+
+    for(int c=0; c<n; c++){
+        values[c] = slot_value(reader, thermal->freq_slot[c]); //kHz
+        values[n + c] = slot_value(reader, thermal->core_throttle_slot[c]);
+    }
+
+    for(int p=0; p<thermal->n_packages; p++){
+        values[2 * n + p] = slot_value(reader, thermal->pkg_throttle_slot[p]);
+    }
+
+    for(int z=0; z<thermal->n_zones; z++){
+        values[zones + z] = slot_value(reader, thermal->zone_slot[z]); //millidegrees Celsius
+    }
+}
+
+void print_thermal(thermal_struct *thermal, long *cur, long *prev, int i){
+    int n = thermal->n_cores, zones = 2 * n + thermal->n_packages, n_freq = 0, printed = 0;
+    long min_freq = 0, max_freq = 0, core_events = 0, pkg_events = 0, pkg_prev = 0, freq_sum = 0;
+
+    for(int c=0; c<n; c++){
+        if(cur[c] < 0) continue; //no cpufreq driver for this core
+
+        if(n_freq == 0 || cur[c] < min_freq) min_freq = cur[c];
+        if(n_freq == 0 || cur[c] > max_freq) max_freq = cur[c];
+        freq_sum += cur[c];
+        n_freq++;
+    }
+
+    if(n_freq > 0){
+        printf(" cpu freq (MHz): min %ld / avg %ld / max %ld\n", min_freq / 1000, freq_sum / n_freq / 1000, max_freq / 1000);
+
+        for(int c=0; c<n; c++){ //per core frequencies, THERMAL_PER_ROW cores to a line
+            if(c % THERMAL_PER_ROW == 0) printf("  cpu%-4d", c);
+            if(cur[c] < 0) printf("     -");
+            else printf(" %5ld", cur[c] / 1000);
+            if(c % THERMAL_PER_ROW == THERMAL_PER_ROW - 1 || c == n - 1) printf("\n");
+        }
+    }
+
+    for(int c=0; c<n; c++){
+        if(cur[n + c] > 0) core_events += cur[n + c];
+    }
+
+    for(int p=0; p<thermal->n_packages; p++){ //one counter per package, summed over the packages
+        if(cur[2 * n + p] > 0) pkg_events += cur[2 * n + p];
+        if(prev[2 * n + p] > 0) pkg_prev += prev[2 * n + p];
+    }
+
+    if(core_events > 0 || pkg_events > 0){
+        printf(" throttle events: %ld core, %ld package", core_events, pkg_events);
+        if(i > 0) printf(" (package +%ld)", pkg_events - pkg_prev);
+        printf("\n");
+
+        for(int c=0; i>0 && c<n; c++){ //lists the cores whose own counter moved since the previous sample
+            long core_diff = cur[n + c] - prev[n + c];
+
+            if(core_diff > 0){
+                printf("%s cpu%d +%ld", printed ? "," : "  throttled cores:", c, core_diff);
+                printed = 1;
+            }
+        }
+        if(printed) printf("\n");
+    }
+
+    if(thermal->n_zones > 0){
+        printf(" thermal zones:");
+        for(int z=0; z<thermal->n_zones; z++){
+            if(cur[zones + z] < 0) printf("%s %s -", z ? "," : "", thermal->zone_type[z]);
+            else printf("%s %s %.1fC", z ? "," : "", thermal->zone_type[z], cur[zones + z] / 1000.0);
+        }
+        printf("\n");
+    }
+}